@@ -21,29 +21,72 @@ CONFIG(debug, debug|release) {
     INCLUDEPATH += $(WEBKIT_ROOT)/WebKitBuild/Release/include/QtWebKitWidgets
 }
 
+# qmake CONFIG+=notracing compiles out the TRACE_* events (see tracerecorder.h)
+CONFIG(notracing): DEFINES += QTRUIBROWSER_NO_TRACING
+
 QMAKE_CXXFLAGS += $$(CXXFLAGS)
 QMAKE_CFLAGS += $$(CFLAGS)
 QMAKE_LFLAGS += $$(LDFLAGS)
 
 SOURCES += \
+    bridgebenchmark.cpp \
     browsersettings.cpp \
     discoveryproxy.cpp \
+    harrecorder.cpp \
+    homepage.cpp \
+    hostlatency.cpp \
+    iconatlas.cpp \
+    iconcache.cpp \
     locationedit.cpp \
     mainwindow.cpp \
+    memorygovernor.cpp \
+    memorypressuremonitor.cpp \
+    navigationbridge.cpp \
+    navigationview.cpp \
+    pageloadtimings.cpp \
     qtruibrowser.cpp \
+    ruichild.cpp \
+    ruilistmodel.cpp \
+    ruinetworkaccessmanager.cpp \
+    ruipagepool.cpp \
+    ruiprefetcher.cpp \
+    ruiprocesshost.cpp \
     ruiwebpage.cpp \
     soapmessage.cpp \
+    startuptrace.cpp \
+    timerwheel.cpp \
+    tracerecorder.cpp \
     userinterface.cpp \
     userinterfacemap.cpp \
     utils.cpp
 
 HEADERS += \
+    bridgebenchmark.h \
     browsersettings.h \
     discoveryproxy.h \
+    harrecorder.h \
+    homepage.h \
+    hostlatency.h \
+    iconatlas.h \
+    iconcache.h \
     locationedit.h \
     mainwindow.h \
+    memorygovernor.h \
+    memorypressuremonitor.h \
+    navigationbridge.h \
+    navigationview.h \
+    pageloadtimings.h \
+    ruichild.h \
+    ruilistmodel.h \
+    ruinetworkaccessmanager.h \
+    ruipagepool.h \
+    ruiprefetcher.h \
+    ruiprocesshost.h \
     ruiwebpage.h \
     soapmessage.h \
+    startuptrace.h \
+    timerwheel.h \
+    tracerecorder.h \
     userinterface.h \
     userinterfacemap.h \
     utils.h \
@@ -62,7 +105,7 @@ CONFIG(debug, debug|release) {
 }
 OBJECTS_DIR = obj
 
-QT += network webkit widgets webkitwidgets xml
+QT += concurrent network webkit widgets webkitwidgets xml
 
 macx:QT += xml
 
@@ -0,0 +1,24 @@
+# Cold vs warm RUI launch time, against a local stand-in for a RUI server.
+#
+# Usage: benchmarklaunch.sh <directory with the RUI's files> [port]
+#
+# Run from the directory holding qtruibrowser.ini. The cold run starts with an empty HTTP cache
+# (cache/directory), the warm run reuses what the cold run cached. Set QTRUIBROWSER to the
+# binary and HTTP_CACHE to the cache directory if they aren't the defaults.
+
+BROWSER=${QTRUIBROWSER:-bin/release/QtRUIBrowser}
+CACHE=${HTTP_CACHE:-httpcache}
+PORT=${2:-8123}
+URL=http://127.0.0.1:$PORT/
+
+(cd "$1" && exec python3 -m http.server $PORT --bind 127.0.0.1) > /dev/null 2>&1 &
+SERVER=$!
+trap "kill $SERVER" EXIT
+sleep 1
+
+echo "Cold launch:"
+rm -rf "$CACHE"
+$BROWSER --benchmark-launch $URL 2>&1 | grep "^Benchmark:"
+
+echo "Warm launch:"
+$BROWSER --benchmark-launch $URL 2>&1 | grep "^Benchmark:"
@@ -0,0 +1,31 @@
+# Cold vs warm startup time: time to the first paint of the navigation page.
+#
+# Usage: benchmarkstartup.sh [runs]
+#
+# Run from the directory holding qtruibrowser.ini. Before each cold run the OS page cache is
+# dropped (needs root; otherwise the "cold" runs are only cold for the browser's own caches:
+# the catalogue snapshot and HTTP cache are removed). Set QTRUIBROWSER to the binary, and
+# CATALOGUE / HTTP_CACHE if the snapshot and cache aren't in their default locations.
+
+BROWSER=${QTRUIBROWSER:-bin/release/QtRUIBrowser}
+CATALOGUE=${CATALOGUE:-qtruibrowser.catalogue}
+CACHE=${HTTP_CACHE:-httpcache}
+RUNS=${1:-5}
+
+run() {
+    $BROWSER --startup-trace --benchmark-startup 2>&1 | grep "^Benchmark:\|^Startup: process"
+}
+
+echo "Cold starts:"
+for i in $(seq $RUNS); do
+    rm -rf "$CATALOGUE" "$CACHE"
+    sync
+    [ -w /proc/sys/vm/drop_caches ] && echo 3 > /proc/sys/vm/drop_caches
+    run
+done
+
+echo "Warm starts:"
+run > /dev/null
+for i in $(seq $RUNS); do
+    run
+done
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "bridgebenchmark.h"
+
+#include "iconatlas.h"
+
+#include <stdio.h>
+#include <QWebPage>
+#include <QWebFrame>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+
+static const int UIS_PER_SERVICE = 10;
+static const int ITERATIONS = 10;
+
+// Renderer benchmark: the navigation page shows 4 panels of a 1000 entry list.
+static const int RENDERER_UIS = 1000;
+static const int RENDERER_ITERATIONS = 50;
+static const int RENDERER_LOAD_TIMEOUT_MS = 10000;
+
+static const char* benchmarkScript =
+    "(function() {"
+    "    var r = %1;"
+    "    var t0 = Date.now();"
+    "    for (var i = 0; i < r; i++) { var l = benchmarkProxy.ruiList(); l[l.length - 1].name; }"
+    "    var t1 = Date.now();"
+    "    for (var i = 0; i < r; i++) { var l = JSON.parse(benchmarkProxy.ruiListJson()); l[l.length - 1].name; }"
+    "    var t2 = Date.now();"
+    "    return [(t1 - t0) / r, (t2 - t1) / r];"
+    "})()";
+
+BridgeBenchmark::BridgeBenchmark(QObject *parent)
+    : QObject(parent)
+    , m_userInterfaceMap(0)
+    , m_page(0)
+{
+}
+
+BridgeBenchmark::~BridgeBenchmark()
+{
+    delete m_userInterfaceMap;
+}
+
+// Here to fill a fresh map with uiCount synthetic UIs, UIS_PER_SERVICE per service.
+void BridgeBenchmark::populate(int uiCount)
+{
+    delete m_userInterfaceMap;
+    m_userInterfaceMap = new UserInterfaceMap;
+    m_services.clear();
+
+    QList<RUIInterface> serviceUIs;
+    int serviceNumber = 0;
+
+    for (int i = 0; i < uiCount; i++) {
+        RUIInterface ui;
+        ui.m_uiID = QString("bench-ui-%1").arg(i);
+        ui.m_name = QString("Benchmark UI %1").arg(i);
+        ui.m_description = "Synthetic UI for the JavaScript bridge benchmark";
+
+        RUIIcon icon;
+        icon.m_mimeType = "image/png";
+        // Bundled icon, so populating the map doesn't start icon fetches.
+        icon.m_url = "qrc:/www/rui_missingIcon.png";
+        icon.m_width = "40";
+        icon.m_height = "40";
+        icon.m_depth = "24";
+        ui.m_iconList.append(icon);
+
+        RUIProtocol protocol;
+        protocol.m_shortName = "DLNA-HTML5-1.0";
+        protocol.m_uriList.append(QString("http://192.168.0.%1/rui/%2/index.html").arg(serviceNumber % 250).arg(i));
+        ui.m_protocolList.append(protocol);
+
+        serviceUIs.append(ui);
+
+        if (serviceUIs.count() == UIS_PER_SERVICE || i == uiCount - 1) {
+            m_userInterfaceMap->addServiceUIs(QString("http://bench/%1/control").arg(serviceNumber), serviceUIs);
+            m_services.append(serviceUIs);
+            serviceUIs.clear();
+            serviceNumber++;
+        }
+    }
+}
+
+void BridgeBenchmark::run()
+{
+    static const int sizes[] = { 50, 500, 5000 };
+
+    QWebPage page;
+    page.mainFrame()->setHtml("<html><body></body></html>");
+    page.mainFrame()->addToJavaScriptWindowObject(QString("benchmarkProxy"), this);
+
+    fprintf(stderr, "\nJavaScript bridge benchmark (ms per call, %d iterations):\n", ITERATIONS);
+    fprintf(stderr, "%8s %12s %14s\n", "UIs", "ruiList()", "ruiListJson()");
+
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        populate(sizes[i]);
+
+        QVariantList result = page.mainFrame()->evaluateJavaScript(QString(benchmarkScript).arg(ITERATIONS)).toList();
+        if (result.count() != 2) {
+            fprintf(stderr, "%8d   benchmark script failed\n", sizes[i]);
+            continue;
+        }
+
+        fprintf(stderr, "%8d %12.2f %14.2f\n", sizes[i], result[0].toDouble(), result[1].toDouble());
+    }
+}
+
+// Here to change the name of one UI, as a re-announced service list would.
+void BridgeBenchmark::renameUI(int serviceNumber, int index, int edition)
+{
+    RUIInterface& ui = m_services[serviceNumber][index];
+    ui.m_name = QString("Benchmark UI %1 (%2)").arg(ui.m_uiID).arg(edition);
+    m_userInterfaceMap->addServiceUIs(QString("http://bench/%1/control").arg(serviceNumber), m_services[serviceNumber]);
+}
+
+void BridgeBenchmark::attachProxy()
+{
+    m_page->mainFrame()->addToJavaScriptWindowObject(QString("discoveryProxy"), this);
+}
+
+void BridgeBenchmark::runRenderer()
+{
+    // Services are ordered by key, so service 0 fills the visible panels and service 50 is
+    // well off screen.
+    static const struct {
+        const char* name;
+        int serviceNumber;
+        bool rebuild;
+    } cases[] = {
+        { "rebuild", 0, true },
+        { "patch, visible", 0, false },
+        { "patch, off screen", 50, false },
+    };
+
+    populate(RENDERER_UIS);
+
+    QWebPage page;
+    m_page = &page;
+    page.setViewportSize(QSize(1280, 720));
+    connect(page.mainFrame(), SIGNAL(javaScriptWindowObjectCleared()), this, SLOT(attachProxy()));
+
+    QEventLoop loop;
+    connect(&page, SIGNAL(loadFinished(bool)), &loop, SLOT(quit()));
+    QTimer::singleShot(RENDERER_LOAD_TIMEOUT_MS, &loop, SLOT(quit()));
+    page.mainFrame()->load(QUrl("qrc:/www/index.html"));
+    loop.exec();
+
+    QImage image(page.viewportSize(), QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer clock;
+    int edition = 0;
+
+    fprintf(stderr, "\nNavigation page renderer benchmark (%d UIs, ms per update, %d iterations):\n",
+            RENDERER_UIS, RENDERER_ITERATIONS);
+    fprintf(stderr, "%-18s %10s %10s %10s\n", "", "script", "layout", "paint");
+
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        qint64 scriptNs = 0;
+        qint64 layoutNs = 0;
+        qint64 paintNs = 0;
+
+        for (int i = 0; i < RENDERER_ITERATIONS; i++) {
+            renameUI(cases[c].serviceNumber, i % 4, ++edition);
+
+            clock.start();
+            if (cases[c].rebuild)
+                page.mainFrame()->evaluateJavaScript("rebuildRUIList()");
+            else
+                emit ruiListNotification();
+            scriptNs += clock.nsecsElapsed();
+
+            // Reading a layout property makes WebKit lay out now, rather than on the next paint.
+            clock.start();
+            page.mainFrame()->evaluateJavaScript("document.body.offsetHeight");
+            layoutNs += clock.nsecsElapsed();
+
+            clock.start();
+            QPainter painter(&image);
+            page.mainFrame()->render(&painter);
+            painter.end();
+            paintNs += clock.nsecsElapsed();
+        }
+
+        fprintf(stderr, "%-18s %10.2f %10.2f %10.2f\n", cases[c].name,
+                scriptNs / 1e6 / RENDERER_ITERATIONS,
+                layoutNs / 1e6 / RENDERER_ITERATIONS,
+                paintNs / 1e6 / RENDERER_ITERATIONS);
+    }
+
+    m_page = 0;
+}
+
+QVariantList BridgeBenchmark::ruiList()
+{
+    return m_userInterfaceMap->generateUIList();
+}
+
+QString BridgeBenchmark::ruiListJson()
+{
+    return m_userInterfaceMap->generateUIListJson();
+}
+
+QString BridgeBenchmark::ruiListDelta(int sinceRevision)
+{
+    return m_userInterfaceMap->generateUIListDelta(sinceRevision);
+}
+
+QString BridgeBenchmark::iconAtlasURL()
+{
+    return IconAtlas::Instance()->url();
+}
+
+void BridgeBenchmark::console(const QString& str)
+{
+    fprintf(stderr, "%s\n", str.toUtf8().data());
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BRIDGEBENCHMARK_H
+#define BRIDGEBENCHMARK_H
+
+#include <QObject>
+#include <QVariant>
+#include <QVariantList>
+#include <QList>
+
+#include "userinterfacemap.h"
+
+class QWebPage;
+
+// Measures the cost of handing the UI list to JavaScript, comparing ruiList() (QVariantList
+// marshalling) with ruiListJson() (one JSON string, parsed in the page). runRenderer() measures
+// the navigation page itself (www/index.html) redrawing after a change: script, layout and
+// paint time per update, for a full rebuild and for patching only the changed panels. The
+// catalogue is synthetic, so no RUI servers are required. Results are written to the console.
+class BridgeBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BridgeBenchmark(QObject *parent = 0);
+    ~BridgeBenchmark();
+
+    void run();
+    void runRenderer();
+
+signals:
+    void ruiListNotification();
+
+public slots:
+    // JavaScript API (bridge), mirrors NavigationBridge
+    QVariantList ruiList();
+    QString ruiListJson();
+    QString ruiListDelta(int sinceRevision);
+    QString iconAtlasURL();
+    void console(const QString&);
+    int scrollIndex() { return 0; }
+    int screenIndex() { return 0; }
+    void setScrollIndex(int) {}
+    void setScreenIndex(int) {}
+    void highlightUI(const QString&) {}
+    void selectUI(const QString&) {}
+
+private slots:
+    void attachProxy();
+
+private:
+    void populate(int uiCount);
+    void renameUI(int serviceNumber, int index, int edition);
+
+    UserInterfaceMap* m_userInterfaceMap;
+    QList<QList<RUIInterface> > m_services;
+    QWebPage* m_page;
+};
+
+#endif // BRIDGEBENCHMARK_H
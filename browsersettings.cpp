@@ -54,6 +54,46 @@ BrowserSettings* BrowserSettings::m_pInstance = NULL;
 #define keyRUIImage       "defaultRUI/image"
 #define keyRUILabel       "defaultRUI/label"
 
+#define keyPersistCatalogue "catalogue/persist"
+#define keySnapshotFile   "catalogue/snapshotFile"
+
+#define keyDeviceMaxAge   "discovery/deviceMaxAge"
+
+#define keyIconCacheDir   "icons/cacheDirectory"
+#define keyIconMemoryCache "icons/memoryCacheKB"
+#define keyIconDiskCache  "icons/diskCacheKB"
+
+#define keyPrerenderEnabled "prerender/enabled"
+#define keyPrerenderDwell "prerender/dwellMs"
+#define keyPrerenderMaxKB "prerender/maxKB"
+
+#define keyPagePoolSize   "pagePool/maxPages"
+#define keyPagePoolMemory "pagePool/memoryBudgetKB"
+
+#define keySparePage      "performance/sparePage"
+
+#define keyCacheEnabled   "cache/enabled"
+#define keyCacheDir       "cache/directory"
+#define keyCacheMaxKB     "cache/maxSizeKB"
+
+#define keyPrefetchEnabled "prefetch/enabled"
+#define keyPrefetchRate   "prefetch/maxKBps"
+#define keyPrefetchPerHost "prefetch/connectionsPerHost"
+#define keyPrefetchMaxKB  "prefetch/maxKB"
+
+#define keyTimeoutFloor   "timeouts/floorSeconds"
+#define keyTimeoutCeiling "timeouts/ceilingSeconds"
+#define keyTimeoutPercentile "timeouts/percentile"
+#define keyFirstByteTimeout "timeouts/firstByteMs"
+
+#define keyMemoryBudget   "memory/budgetMB"
+#define keyMemoryRetune   "memory/retuneSeconds"
+
+#define keyNativeNavigation "navigation/native"
+
+#define keyProcessPerRUI  "performance/processPerRUI"
+#define keyChildHang      "performance/childHangSeconds"
+
 BrowserSettings::BrowserSettings(QObject *parent)
     : QSettings("qtruibrowser.ini", QSettings::IniFormat, parent)
 {
@@ -106,6 +146,75 @@ BrowserSettings::BrowserSettings(QObject *parent)
     if (contains(keyProxyType))
         proxyType = value(keyProxyType).toString();
 
+    if (contains(keyPersistCatalogue))
+        persistCatalogue = value(keyPersistCatalogue).toBool();
+    if (contains(keySnapshotFile))
+        catalogueSnapshotFile = value(keySnapshotFile).toString();
+
+    if (contains(keyDeviceMaxAge))
+        deviceMaxAge = value(keyDeviceMaxAge).toInt();
+
+    if (contains(keyIconCacheDir))
+        iconCacheDirectory = value(keyIconCacheDir).toString();
+    if (contains(keyIconMemoryCache))
+        iconMemoryCacheKB = value(keyIconMemoryCache).toInt();
+    if (contains(keyIconDiskCache))
+        iconDiskCacheKB = value(keyIconDiskCache).toInt();
+
+    if (contains(keyPrerenderEnabled))
+        prerenderEnabled = value(keyPrerenderEnabled).toBool();
+    if (contains(keyPrerenderDwell))
+        prerenderDwellMs = value(keyPrerenderDwell).toInt();
+    if (contains(keyPrerenderMaxKB))
+        prerenderMaxKB = value(keyPrerenderMaxKB).toInt();
+
+    if (contains(keyPagePoolSize))
+        pagePoolSize = value(keyPagePoolSize).toInt();
+    if (contains(keyPagePoolMemory))
+        pagePoolMemoryKB = value(keyPagePoolMemory).toInt();
+
+    if (contains(keySparePage))
+        sparePageEnabled = value(keySparePage).toBool();
+
+    if (contains(keyCacheEnabled))
+        httpCacheEnabled = value(keyCacheEnabled).toBool();
+    if (contains(keyCacheDir))
+        httpCacheDirectory = value(keyCacheDir).toString();
+    if (contains(keyCacheMaxKB))
+        httpCacheMaxKB = value(keyCacheMaxKB).toInt();
+
+    if (contains(keyPrefetchEnabled))
+        prefetchEnabled = value(keyPrefetchEnabled).toBool();
+    if (contains(keyPrefetchRate))
+        prefetchMaxKBps = value(keyPrefetchRate).toInt();
+    if (contains(keyPrefetchPerHost))
+        prefetchPerHost = value(keyPrefetchPerHost).toInt();
+    if (contains(keyPrefetchMaxKB))
+        prefetchMaxKB = value(keyPrefetchMaxKB).toInt();
+
+    if (contains(keyTimeoutFloor))
+        timeoutFloorSeconds = value(keyTimeoutFloor).toInt();
+    if (contains(keyTimeoutCeiling))
+        timeoutCeilingSeconds = value(keyTimeoutCeiling).toInt();
+    if (contains(keyTimeoutPercentile))
+        timeoutPercentile = value(keyTimeoutPercentile).toInt();
+    if (contains(keyFirstByteTimeout))
+        firstByteTimeoutMs = value(keyFirstByteTimeout).toInt();
+
+    if (contains(keyMemoryBudget))
+        memoryBudgetMB = value(keyMemoryBudget).toInt();
+    if (contains(keyMemoryRetune))
+        memoryRetuneSeconds = value(keyMemoryRetune).toInt();
+
+    if (contains(keyNativeNavigation))
+        nativeNavigation = value(keyNativeNavigation).toBool();
+
+    if (contains(keyProcessPerRUI))
+        processPerRUI = value(keyProcessPerRUI).toBool();
+    if (contains(keyChildHang))
+        childHangSeconds = value(keyChildHang).toInt();
+
+    // Adds any settings missing from the ini file. Nothing is written if none are.
     save();
 }
 
@@ -136,35 +245,122 @@ void BrowserSettings::generateDefaults()
     proxyHost = "127.0.1.1";
     proxyPort = 8888;   // Charles Web Proxy
     proxyType = "HTTP";
+
+    persistCatalogue = true;
+    catalogueSnapshotFile = "qtruibrowser.catalogue";
+
+    deviceMaxAge = 1800;
+
+    iconCacheDirectory = "iconcache";
+    iconMemoryCacheKB = 2048;
+    iconDiskCacheKB = 8192;
+
+    prerenderEnabled = false;
+    prerenderDwellMs = 750;
+    prerenderMaxKB = 16384;
+
+    pagePoolSize = 3;
+    pagePoolMemoryKB = 65536;
+
+    sparePageEnabled = true;
+
+    httpCacheEnabled = true;
+    httpCacheDirectory = "httpcache";
+    httpCacheMaxKB = 51200;
+
+    prefetchEnabled = true;
+    prefetchMaxKBps = 256;
+    prefetchPerHost = 1;
+    prefetchMaxKB = 8192;
+
+    timeoutFloorSeconds = 3;
+    timeoutCeilingSeconds = 30;
+    timeoutPercentile = 95;
+    firstByteTimeoutMs = 2000;
+
+    memoryBudgetMB = 0;
+    memoryRetuneSeconds = 15;
+
+    nativeNavigation = false;
+
+    processPerRUI = false;
+    childHangSeconds = 10;
+}
+
+// Here to only write settings that changed; QSettings rewrites the file on any setValue().
+void BrowserSettings::store(const char* key, const QVariant& newValue)
+{
+    if (!contains(key) || value(key).toString() != newValue.toString())
+        setValue(key, newValue);
 }
 
 void BrowserSettings::save()
 {
-    setValue(keyTitleBar, hasTitleBar);
-    setValue(keyMenuBar, hasMenuBar);
-    setValue(keyNavigationBar, hasNavigationBar);
-    setValue(keyStartFullScreen, startFullScreen);
-    setValue(keyStaysOnTop, staysOnTop);
-
-    setValue(keyUrlEdit, hasUrlEdit);
-    setValue(keyHomeButton, hasHomeButton);
-    setValue(keyBackButton, hasBackButton);
-    setValue(keyReloadButton, hasReloadButton);
-    setValue(keyForwardButton, hasForwardButton);
-    setValue(keyStopButton, hasStopButton);
-    setValue(keyWebInspector, hasWebInspector);
-
-    setValue(keyCertID, certID);
-    setValue(keyTVRemoteUrl, tvRemoteURL);
-
-    setValue(keyRUIUrl, defaultRUIUrl);
-    setValue(keyRUIImage, defaultRUIImage);
-    setValue(keyRUILabel, defaultRUILabel);
-
-    setValue(keyProxyEnabled, proxyEnabled);
-    setValue(keyProxyHost, proxyHost);
-    setValue(keyProxyPort, proxyPort);
-    setValue(keyProxyType, proxyType);
+    store(keyTitleBar, hasTitleBar);
+    store(keyMenuBar, hasMenuBar);
+    store(keyNavigationBar, hasNavigationBar);
+    store(keyStartFullScreen, startFullScreen);
+    store(keyStaysOnTop, staysOnTop);
+
+    store(keyUrlEdit, hasUrlEdit);
+    store(keyHomeButton, hasHomeButton);
+    store(keyBackButton, hasBackButton);
+    store(keyReloadButton, hasReloadButton);
+    store(keyForwardButton, hasForwardButton);
+    store(keyStopButton, hasStopButton);
+    store(keyWebInspector, hasWebInspector);
+
+    store(keyCertID, certID);
+    store(keyTVRemoteUrl, tvRemoteURL);
+
+    store(keyRUIUrl, defaultRUIUrl);
+    store(keyRUIImage, defaultRUIImage);
+    store(keyRUILabel, defaultRUILabel);
+
+    store(keyProxyEnabled, proxyEnabled);
+    store(keyProxyHost, proxyHost);
+    store(keyProxyPort, proxyPort);
+    store(keyProxyType, proxyType);
+
+    store(keyPersistCatalogue, persistCatalogue);
+    store(keySnapshotFile, catalogueSnapshotFile);
+
+    store(keyDeviceMaxAge, deviceMaxAge);
+
+    store(keyIconCacheDir, iconCacheDirectory);
+    store(keyIconMemoryCache, iconMemoryCacheKB);
+    store(keyIconDiskCache, iconDiskCacheKB);
+
+    store(keyPrerenderEnabled, prerenderEnabled);
+    store(keyPrerenderDwell, prerenderDwellMs);
+    store(keyPrerenderMaxKB, prerenderMaxKB);
+
+    store(keyPagePoolSize, pagePoolSize);
+    store(keyPagePoolMemory, pagePoolMemoryKB);
+
+    store(keySparePage, sparePageEnabled);
+
+    store(keyCacheEnabled, httpCacheEnabled);
+    store(keyCacheDir, httpCacheDirectory);
+    store(keyCacheMaxKB, httpCacheMaxKB);
+
+    store(keyPrefetchEnabled, prefetchEnabled);
+    store(keyPrefetchRate, prefetchMaxKBps);
+    store(keyPrefetchPerHost, prefetchPerHost);
+    store(keyPrefetchMaxKB, prefetchMaxKB);
+
+    store(keyTimeoutFloor, timeoutFloorSeconds);
+    store(keyTimeoutCeiling, timeoutCeilingSeconds);
+    store(keyTimeoutPercentile, timeoutPercentile);
+    store(keyFirstByteTimeout, firstByteTimeoutMs);
+
+    store(keyMemoryBudget, memoryBudgetMB);
+    store(keyMemoryRetune, memoryRetuneSeconds);
+
+    store(keyNativeNavigation, nativeNavigation);
+
+    store(keyProcessPerRUI, processPerRUI);
+    store(keyChildHang, childHangSeconds);
 }
 
 BrowserSettings* BrowserSettings::Instance()
@@ -39,6 +39,7 @@ public:
 private:
     static BrowserSettings* m_pInstance;
     void generateDefaults();
+    void store(const char* key, const QVariant& value);
 
 public:
     bool hasTitleBar;
@@ -62,6 +63,34 @@ public:
     QString defaultRUIImage;
     QString defaultRUILabel;
     QString tvRemoteURL;
+    bool persistCatalogue;
+    QString catalogueSnapshotFile;
+    int  deviceMaxAge;
+    QString iconCacheDirectory;
+    int  iconMemoryCacheKB;
+    int  iconDiskCacheKB;
+    bool prerenderEnabled;
+    int  prerenderDwellMs;
+    int  prerenderMaxKB;
+    int  pagePoolSize;
+    int  pagePoolMemoryKB;
+    bool sparePageEnabled;
+    bool httpCacheEnabled;
+    QString httpCacheDirectory;
+    int  httpCacheMaxKB;
+    bool prefetchEnabled;
+    int  prefetchMaxKBps;
+    int  prefetchPerHost;
+    int  prefetchMaxKB;
+    int  timeoutFloorSeconds;
+    int  timeoutCeilingSeconds;
+    int  timeoutPercentile;
+    int  firstByteTimeoutMs;
+    int  memoryBudgetMB;
+    int  memoryRetuneSeconds;
+    bool nativeNavigation;
+    bool processPerRUI;
+    int  childHangSeconds;
     void save();
 };
 
@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include "discoveryproxy.h"
+#include "tracerecorder.h"
 #include "soapmessage.h"
 
 #include <stdio.h>
@@ -40,6 +41,8 @@
 #include <QVariantMap>
 #include <QTextDocument>
 #include "ruiwebpage.h"
+#include "browsersettings.h"
+#include "iconatlas.h"
 
 DiscoveryProxy* DiscoveryProxy::m_pInstance = NULL;
 
@@ -48,41 +51,123 @@ const char* schema_device = "urn:schemas-dlna-org:device-1-0";
 const char* service_type = "urn:schemas-upnp-org:service:RemoteUIServer:1";
 const char* service_urn = "urn:upnp-org:serviceId:RemoteUIServer";
 
+// Catalogue changes tend to arrive in bursts (one SOAP reply per service), so the snapshot
+// is written once things settle.
+static const int SNAPSHOT_DELAY_MS = 2000;
+
+// How long a preconnected host counts as warm. Idle connections are not kept much longer than
+// this by the network access manager.
+static const int PRECONNECT_WINDOW_MS = 60000;
+
 
 DiscoveryProxy::DiscoveryProxy()
-    : m_home(false)
-    , m_soapHttp(this)
+    : m_soapHttp(this)
     , m_http(this)
-    , m_scrollIndex(0)
-    , m_screenIndex(0)
+    , m_snapshotLoaded(false)
+    , m_discoveryStarted(false)
+    , m_preconnectManager(0)
+    , m_preconnectCount(0)
+    , m_preconnectUsed(0)
+    , m_preconnectMissed(0)
 {
+    m_preconnectClock.start();
+
     // Connect signals to slots.
     connect(&m_http, SIGNAL(finished(QNetworkReply*)), this, SLOT(httpReply(QNetworkReply*)));
     connect(&m_soapHttp, SIGNAL(finished(QNetworkReply*)), this, SLOT(soapHttpReply(QNetworkReply*)));
     connect(this, SIGNAL(ruiDeviceAvailable(QString)), this, SLOT(requestDeviceDescription(QString)));
+    connect(this, SIGNAL(ruiDeviceListReceived(QStringList)), this, SLOT(removeMissingDevices(QStringList)));
+    connect(&m_userInterfaceMap, SIGNAL(devicesExpired(int)), this, SLOT(onDevicesExpired(int)));
+    connect(IconAtlas::Instance(), SIGNAL(changed()), this, SLOT(onIconAtlasChanged()));
+
+    // Seed the catalogue from the last session, so the navigation page has entries before
+    // discovery completes. The entries are revalidated when discovery starts.
+    m_snapshotTimer.setInterval(SNAPSHOT_DELAY_MS);
+    m_snapshotTimer.setSingleShot(true);
+    connect(&m_snapshotTimer, SIGNAL(timeout()), this, SLOT(saveSnapshot()));
+
+    BrowserSettings* settings = BrowserSettings::Instance();
+    if (settings->persistCatalogue) {
+        m_snapshotLoaded = m_userInterfaceMap.loadSnapshot(settings->catalogueSnapshotFile, settings->deviceMaxAge);
+    }
+}
+
+// Here once the navigation page is up, so discovery traffic doesn't compete with startup.
+void DiscoveryProxy::startDiscovery()
+{
+    if (m_discoveryStarted)
+        return;
+    m_discoveryStarted = true;
+
+    if (m_snapshotLoaded)
+        revalidateSnapshot();
 
-    // Start discovery
     DiscoveryWrapper::startUPnPInternalDiscovery(service_type, this );
 }
 
-int DiscoveryProxy::scrollIndex()
+void DiscoveryProxy::setPreconnectManager(QNetworkAccessManager* manager)
 {
-    return m_scrollIndex;
+    m_preconnectManager = manager;
 }
 
-int DiscoveryProxy::screenIndex()
+// Here when a navigation page highlights a RUI. Resolve its host and open a connection now, ahead
+// of the user pressing enter.
+void DiscoveryProxy::preconnect(const QString& uri)
 {
-    return m_screenIndex;
+    QUrl url(uri);
+    QString scheme = url.scheme();
+    if (!m_preconnectManager || url.host().isEmpty() || (scheme != "http" && scheme != "https"))
+        return;
+
+    bool secure = (scheme == "https");
+    int port = url.port(secure ? 443 : 80);
+    QString hostKey = QString("%1:%2").arg(url.host()).arg(port);
+
+    // Still warm from an earlier highlight.
+    qint64 now = m_preconnectClock.elapsed();
+    if (m_preconnectedHosts.contains(hostKey) && now - m_preconnectedHosts[hostKey] < PRECONNECT_WINDOW_MS)
+        return;
+
+    // Both resolve the host name (through Qt's host info cache) before connecting.
+    if (secure) {
+        m_preconnectManager->connectToHostEncrypted(url.host(), port);
+    } else {
+        m_preconnectManager->connectToHost(url.host(), port);
+    }
+
+    m_preconnectedHosts.insert(hostKey, now);
+    m_preconnectCount++;
 }
 
-void DiscoveryProxy::setScrollIndex(int index)
+// Here when a page load starts. Record whether it went to a host we had warmed up.
+void DiscoveryProxy::notePageLoad(const QUrl& url)
 {
-    m_scrollIndex = index;
+    QString scheme = url.scheme();
+    if (scheme != "http" && scheme != "https")
+        return;
+
+    int port = url.port(scheme == "https" ? 443 : 80);
+    QString hostKey = QString("%1:%2").arg(url.host()).arg(port);
+
+    if (m_preconnectedHosts.contains(hostKey)
+        && m_preconnectClock.elapsed() - m_preconnectedHosts[hostKey] < PRECONNECT_WINDOW_MS) {
+        m_preconnectUsed++;
+    } else {
+        m_preconnectMissed++;
+    }
+
+    m_preconnectedHosts.remove(hostKey);
 }
 
-void DiscoveryProxy::setScreenIndex(int index)
+void DiscoveryProxy::dumpPreconnectStatistics()
 {
-    m_screenIndex = index;
+    int loads = m_preconnectUsed + m_preconnectMissed;
+    fprintf(stderr, "\nPreconnect statistics:\n");
+    fprintf(stderr, "- preconnects: %d\n", m_preconnectCount);
+    fprintf(stderr, "- page loads: %d\n", loads);
+    fprintf(stderr, "- loads using a warm connection: %d (%.0f%%)\n",
+            m_preconnectUsed, loads ? (100.0 * m_preconnectUsed) / loads : 0.0);
+    fprintf(stderr, "- preconnects not used (yet): %d\n", m_preconnectCount - m_preconnectUsed);
 }
 
 // Here with an updated server list from the Disovery module (callback)
@@ -112,12 +197,16 @@ void DiscoveryProxy::requestDeviceDescription( QString url)
     networkReq.setHeader(QNetworkRequest::ContentTypeHeader, QLatin1String("text/xml;charset=utf-8"));
     networkReq.setUrl(url);
 
-    m_http.get(networkReq);
+    // Ended in httpReply(), so the trace shows how long the fetch took.
+    QNetworkReply* reply = m_http.get(networkReq);
+    TRACE_ASYNC_BEGIN("discovery", "fetch device description", reply);
 }
 
-// Here to request a device description for each server
+// Here to request a device description for each server, and push out its expiry.
 void DiscoveryProxy::processDeviceList(UPnPDeviceList deviceList)
 {
+    TRACE_SCOPE("discovery", "processDeviceList");
+
     QStringList devices;
 
     // Request device descriptions
@@ -127,20 +216,77 @@ void DiscoveryProxy::processDeviceList(UPnPDeviceList deviceList)
         // Process device on main thread.
         emit ruiDeviceAvailable(QString(device.descURL.c_str()));
 
+        // Devices that stop advertising without leaving the list are removed by UserInterfaceMap
+        // when this expires.
+        m_userInterfaceMap.touchDevice(QString(device.uuid.c_str()), deviceMaxAge(device));
         devices.append(QString(device.uuid.c_str()));
     }
 
-    // Check for deletions
-    int deleteCount = m_userInterfaceMap.checkForRemovedDevices(devices);
-    if (deleteCount > 0) {
+    // Check for deletions, on the main thread.
+    emit ruiDeviceListReceived(devices);
+}
+
+// Here with the full server list: devices that have left it (switched off) go right away.
+void DiscoveryProxy::removeMissingDevices(QStringList devices)
+{
+    if (m_userInterfaceMap.removeMissingDevices(devices) > 0)
         notifyListChanged();
-    }
+}
+
+// SSDP CACHE-CONTROL max-age for a device. The discovery module does not pass the advertised
+// max-age through UPnPDevice, so the configured default is used for every device.
+int DiscoveryProxy::deviceMaxAge(const UPnPDevice&)
+{
+    return BrowserSettings::Instance()->deviceMaxAge;
 }
 
 void DiscoveryProxy::notifyListChanged()
 {
-    if (m_home)
-        emit ruiListNotification();
+    TRACE_INSTANT("discovery", "list changed");
+
+    scheduleSnapshot();
+
+    // Each window's NavigationBridge passes this on to its navigation page once it's showing.
+    emit ruiListNotification();
+}
+
+void DiscoveryProxy::onDevicesExpired(int)
+{
+    notifyListChanged();
+}
+
+// New icons were painted into the atlas. The list itself is unchanged, but the page needs to
+// pick up the new atlas generation.
+void DiscoveryProxy::onIconAtlasChanged()
+{
+    emit ruiListNotification();
+}
+
+// May be called from the discovery thread, so start the timer through the event loop.
+void DiscoveryProxy::scheduleSnapshot()
+{
+    if (BrowserSettings::Instance()->persistCatalogue)
+        QMetaObject::invokeMethod(&m_snapshotTimer, "start", Qt::QueuedConnection);
+}
+
+void DiscoveryProxy::saveSnapshot()
+{
+    m_userInterfaceMap.saveSnapshot(BrowserSettings::Instance()->catalogueSnapshotFile);
+}
+
+// Here after a snapshot was loaded. Speculatively re-fetch the known device descriptions and
+// UI lists, rather than waiting for SSDP responses. Replies are handled as usual, replacing
+// the stale entries; devices that are gone drop out on the next server list update.
+void DiscoveryProxy::revalidateSnapshot()
+{
+    foreach (QString url, m_userInterfaceMap.deviceDescriptionURLs()) {
+        requestDeviceDescription(url);
+    }
+
+    foreach (QString controlURL, m_userInterfaceMap.staleServiceKeys()) {
+        m_revalidatedServices.insert(controlURL);
+        requestCompatibleUIs(controlURL);
+    }
 }
 
 // Compare device service type with ours, allowing for later versions on the device
@@ -158,6 +304,8 @@ bool DiscoveryProxy::checkServiceType(const QString& presentedType)
 // Here with a new root device description. Process the root device and any nested devices.
 void DiscoveryProxy::processDevice(const QString& url, const QDomDocument& document)
 {
+    TRACE_SCOPE("discovery", "processDevice");
+
     fprintf(stderr,"processDevice. url: %s\n", url.toUtf8().data());
     QString baseURL = url.left(url.lastIndexOf("/"));
 
@@ -204,6 +352,7 @@ void DiscoveryProxy::processDevice(const QString& url, const QDomDocument& docum
         ruiDevice.m_uuid = uuid;
         ruiDevice.m_rootDeviceUuid = rootDeviceUuid;
         ruiDevice.m_baseURL = baseURL;
+        ruiDevice.m_descriptionURL = url;
 
         // We are only interested devices that implement the the RemoteUIServer service.
         QDomElement serviceList = device.firstChildElement("serviceList");
@@ -276,8 +425,11 @@ void DiscoveryProxy::processDevice(const QString& url, const QDomDocument& docum
 
                     ruiDevice.m_serviceList.append(ruiService);
 
-                    fprintf(stderr, "Request Compatible UIs: %s\n", ruiService.m_controlURL.toUtf8().data());
-                    requestCompatibleUIs(ruiService.m_controlURL);
+                    // Already requested by revalidateSnapshot() in this pass.
+                    if (!m_revalidatedServices.remove(ruiService.m_controlURL)) {
+                        fprintf(stderr, "Request Compatible UIs: %s\n", ruiService.m_controlURL.toUtf8().data());
+                        requestCompatibleUIs(ruiService.m_controlURL);
+                    }
                 } else {
                     fprintf( stderr, "No compatible service\n");
                         }
@@ -300,6 +452,8 @@ void DiscoveryProxy::processDevice(const QString& url, const QDomDocument& docum
 
 void DiscoveryProxy::processUIList(const QString& url, const QDomDocument& document)
 {
+    TRACE_SCOPE("discovery", "merge UI list");
+
     QString baseURL = url.left(url.lastIndexOf("/"));
 
     QString serviceKey = url;
@@ -429,11 +583,17 @@ void DiscoveryProxy::requestCompatibleUIs(const QString& url)
 
     QNetworkReply* reply = m_soapHttp.post(networkReq, xml.toUtf8());
     reply->setReadBufferSize(1024*250); // 7.3.2.15.2
+
+    // Ended in soapHttpReply().
+    TRACE_ASYNC_BEGIN("discovery", "fetch compatible UIs", reply);
 }
 
 // We have received a RUI Server Description. Parse the control URL and request compatible UIs.
 void DiscoveryProxy::httpReply(QNetworkReply* reply)
 {
+    TRACE_ASYNC_END("discovery", "fetch device description", reply);
+    TRACE_SCOPE("discovery", "parse device description");
+
     if (reply->error() != QNetworkReply::NoError) {
         int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         QString httpStatusMessage = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray();
@@ -462,6 +622,9 @@ void DiscoveryProxy::httpReply(QNetworkReply* reply)
 // We have received a list of compatible UIs
 void DiscoveryProxy::soapHttpReply(QNetworkReply* reply)
 {
+    TRACE_ASYNC_END("discovery", "fetch compatible UIs", reply);
+    TRACE_SCOPE("discovery", "parse compatible UIs");
+
     int errorCode = reply->error();
     QString errorString = reply->errorString();
     if (errorCode != QNetworkReply::NoError) {
@@ -536,16 +699,36 @@ void DiscoveryProxy::dumpUserInterfaceMap()
     m_userInterfaceMap.dumpToConsole();
 }
 
-// Here to return a list of RUIs to javascript
+// Here to return a list of RUIs for javascript
 QVariantList DiscoveryProxy::ruiList()
 {
+    TRACE_SCOPE("bridge", "ruiList");
+
     return m_userInterfaceMap.generateUIList();
 }
 
-// JavaScript output to application console.
-void DiscoveryProxy::console(const QString& str)
+// Here to return the list of RUIs for javascript as a JSON string (see ruiList())
+QString DiscoveryProxy::ruiListJson()
+{
+    TRACE_SCOPE("bridge", "ruiListJson");
+
+    return m_userInterfaceMap.generateUIListJson();
+}
+
+// Here to return the changes to the list of RUIs since the page's last update, as a JSON string.
+// The navigation page patches only the panels showing a changed UI.
+QString DiscoveryProxy::ruiListDelta(int sinceRevision)
 {
-    fprintf( stderr,"%s\n", str.toUtf8().data());
+    TRACE_SCOPE("bridge", "ruiListDelta");
+
+    return m_userInterfaceMap.generateUIListDelta(sinceRevision);
+}
+
+// Here to return the URL of the current icon atlas for javascript. UIs with an "atlas" cell
+// are drawn from this image.
+QString DiscoveryProxy::iconAtlasURL()
+{
+    return IconAtlas::Instance()->url();
 }
 
 DiscoveryProxy* DiscoveryProxy::Instance()
@@ -562,3 +745,12 @@ bool DiscoveryProxy::isHostRUITransportServer(const QString& hostURL)
     return m_userInterfaceMap.isHostRUITransportServer(hostURL);
 }
 
+QStringList DiscoveryProxy::launchURIs()
+{
+    return m_userInterfaceMap.launchURIs();
+}
+
+void DiscoveryProxy::trimMemory()
+{
+    m_userInterfaceMap.trimMemory();
+}
@@ -37,7 +37,12 @@ using namespace WebCore;
 #include <QVariantMap>
 #include <QDomDocument>
 #include <QNetworkAccessManager>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QSet>
 
+#include "ruinetworkaccessmanager.h"
 #include "userinterfacemap.h"
 Q_DECLARE_METATYPE(UPnPDevice)
 
@@ -48,23 +53,52 @@ class DiscoveryProxy : public QObject, public IDiscoveryAPI
 public:
     static DiscoveryProxy* Instance();
 
+    void startDiscovery();
     bool isHostRUITransportServer(const QString& hostURL);
+    QStringList launchURIs();
+
+    // Speculative preconnect to the highlighted RUI. Uses the page's network access manager,
+    // so the warmed connection is the one the page load picks up.
+    void setPreconnectManager(QNetworkAccessManager* manager);
+    void preconnect(const QString& uri);
+    void notePageLoad(const QUrl& url);
+
+    // The catalogue, as handed to the navigation pages (see NavigationBridge).
+    QVariantList ruiList();
+    QString ruiListJson();
+    QString ruiListDelta(int sinceRevision);
+    QString iconAtlasURL();
+
+    void trimMemory();
 
     // Debugging
     void dumpUserInterfaceMap();
-    bool m_home;
+    void dumpPreconnectStatistics();
 
 private:
     DiscoveryProxy();
     static DiscoveryProxy* m_pInstance;
     UserInterfaceMap m_userInterfaceMap;
-    QNetworkAccessManager m_soapHttp;
-    QNetworkAccessManager m_http;
+    RUINetworkAccessManager m_soapHttp;
+    RUINetworkAccessManager m_http;
+    QTimer m_snapshotTimer;
+    bool m_snapshotLoaded;
+    QSet<QString> m_revalidatedServices;  // control URLs already asked for their UIs by revalidateSnapshot()
+    bool m_discoveryStarted;
+
+    QNetworkAccessManager* m_preconnectManager;
+    QMap<QString, qint64> m_preconnectedHosts;  // host:port -> time of preconnect
+    QElapsedTimer m_preconnectClock;
+    int m_preconnectCount;
+    int m_preconnectUsed;
+    int m_preconnectMissed;
 
     void processDeviceList(UPnPDeviceList);
+    int deviceMaxAge(const UPnPDevice&);
     void processDevice(const QString& url, const QDomDocument& document);
     void processUIList(const QString& url, const QDomDocument& document);
     void notifyListChanged();
+    void scheduleSnapshot();
     void requestCompatibleUIs(const QString&);
     QString trimElementText(const QString&);
     QString elementTextForTag(const QDomNode& parent, const QString& tag);
@@ -74,15 +108,7 @@ private:
 signals:
     void ruiListNotification();
     void ruiDeviceAvailable(QString);
-
-public slots:
-    // Public JavaScript API (bridge)
-    QVariantList ruiList();
-    void console(const QString&);
-    int scrollIndex();
-    int screenIndex();
-    void setScrollIndex(int index);
-    void setScreenIndex(int index);
+    void ruiDeviceListReceived(QStringList);
 
 private slots:
     // IDiscoveryAPI
@@ -100,17 +126,18 @@ private slots:
 
     // For executing on main thread.
     void requestDeviceDescription(QString);
+    void removeMissingDevices(QStringList);
+
+    // Persisted catalogue
+    void saveSnapshot();
+    void revalidateSnapshot();
+
+    void onDevicesExpired(int count);
+    void onIconAtlasChanged();
 
     // HTTP
     void httpReply(QNetworkReply*);
     void soapHttpReply(QNetworkReply*);
-
-public:
-    // JavaScript state variables
-    // These public variables are used to persist state on the navigation page, so when you return
-    // from a rui page, the last selected row and scroll position are restored.
-    int m_scrollIndex;
-    int m_screenIndex;
 };
 
 #endif // DISCOVERYPROXY_H
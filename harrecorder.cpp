@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "harrecorder.h"
+
+#include <stdio.h>
+#include <QFile>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QUrlQuery>
+#include <QVariantList>
+
+// Here to bound the memory used by a recording left running; the oldest entries are dropped.
+static const int MAX_ENTRIES = 5000;
+
+HarRecorder* HarRecorder::m_pInstance = NULL;
+
+static QString methodName(QNetworkAccessManager::Operation op, const QNetworkRequest& request)
+{
+    switch (op) {
+    case QNetworkAccessManager::HeadOperation:   return "HEAD";
+    case QNetworkAccessManager::GetOperation:    return "GET";
+    case QNetworkAccessManager::PutOperation:    return "PUT";
+    case QNetworkAccessManager::PostOperation:   return "POST";
+    case QNetworkAccessManager::DeleteOperation: return "DELETE";
+    default:
+        return QString::fromLatin1(request.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray());
+    }
+}
+
+static QVariantMap nameValue(const QString& name, const QString& value)
+{
+    QVariantMap pair;
+    pair["name"] = name;
+    pair["value"] = value;
+    return pair;
+}
+
+HarRecorder::HarRecorder()
+    : m_recording(false)
+{
+}
+
+HarRecorder* HarRecorder::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new HarRecorder;
+    }
+
+    return m_pInstance;
+}
+
+void HarRecorder::setRecording(bool recording)
+{
+    m_recording = recording;
+    fprintf(stderr, "HAR recording %s (%d entries)\n", recording ? "started" : "stopped", m_entries.count());
+}
+
+void HarRecorder::clear()
+{
+    m_entries.clear();
+}
+
+void HarRecorder::track(QNetworkReply* reply, QNetworkAccessManager::Operation op, const QNetworkRequest& request, qint64 requestBodySize)
+{
+    Entry entry;
+    entry.started = QDateTime::currentDateTime();
+    entry.clock.start();
+    entry.method = methodName(op, request);
+    entry.request = request;
+    entry.requestBodySize = requestBodySize;
+    entry.firstByte = -1;
+    entry.bytesReceived = 0;
+    m_pending.insert(reply, entry);
+
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(onMetaDataChanged()));
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(finished()), this, SLOT(onFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(onDestroyed(QObject*)));
+}
+
+void HarRecorder::onMetaDataChanged()
+{
+    QHash<QObject*, Entry>::iterator it = m_pending.find(sender());
+    if (it != m_pending.end() && it->firstByte < 0)
+        it->firstByte = it->clock.elapsed();
+}
+
+void HarRecorder::onDownloadProgress(qint64 received, qint64)
+{
+    QHash<QObject*, Entry>::iterator it = m_pending.find(sender());
+    if (it != m_pending.end())
+        it->bytesReceived = received;
+}
+
+void HarRecorder::onFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_pending.contains(reply))
+        return;
+
+    Entry entry = m_pending.take(reply);
+    m_entries.append(harEntry(reply, entry));
+    while (m_entries.count() > MAX_ENTRIES) {
+        m_entries.removeFirst();
+    }
+}
+
+// Replies deleted before finishing (aborted pages) are dropped.
+void HarRecorder::onDestroyed(QObject* object)
+{
+    m_pending.remove(object);
+}
+
+QVariantMap HarRecorder::harEntry(QNetworkReply* reply, const Entry& entry) const
+{
+    qint64 total = entry.clock.elapsed();
+    qint64 wait = entry.firstByte >= 0 ? entry.firstByte : total;
+    bool fromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+
+    QVariantList requestHeaders;
+    foreach (const QByteArray& name, entry.request.rawHeaderList()) {
+        requestHeaders.append(nameValue(name, entry.request.rawHeader(name)));
+    }
+
+    QVariantList queryString;
+    typedef QPair<QString, QString> QueryItem;
+    foreach (const QueryItem& item, QUrlQuery(entry.request.url()).queryItems()) {
+        queryString.append(nameValue(item.first, item.second));
+    }
+
+    QVariantMap request;
+    request["method"] = entry.method;
+    request["url"] = entry.request.url().toString();
+    request["httpVersion"] = "HTTP/1.1";
+    request["cookies"] = QVariantList();
+    request["headers"] = requestHeaders;
+    request["queryString"] = queryString;
+    request["headersSize"] = -1;
+    request["bodySize"] = entry.requestBodySize;
+
+    QVariantList responseHeaders;
+    typedef QPair<QByteArray, QByteArray> RawHeader;
+    foreach (const RawHeader& header, reply->rawHeaderPairs()) {
+        responseHeaders.append(nameValue(header.first, header.second));
+    }
+
+    QVariantMap content;
+    content["size"] = entry.bytesReceived;
+    content["mimeType"] = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+
+    QVariantMap response;
+    response["status"] = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    response["statusText"] = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toString();
+    response["httpVersion"] = "HTTP/1.1";
+    response["cookies"] = QVariantList();
+    response["headers"] = responseHeaders;
+    response["content"] = content;
+    response["redirectURL"] = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl().toString();
+    response["headersSize"] = -1;
+    response["bodySize"] = fromCache ? 0 : entry.bytesReceived;
+
+    QVariantMap timings;
+    timings["blocked"] = -1;
+    timings["dns"] = -1;
+    timings["connect"] = -1;
+    timings["ssl"] = -1;
+    timings["send"] = 0;
+    timings["wait"] = wait;
+    timings["receive"] = total - wait;
+
+    QVariantMap har;
+    har["startedDateTime"] = entry.started.toString(Qt::ISODate);
+    har["time"] = total;
+    har["request"] = request;
+    har["response"] = response;
+    har["cache"] = QVariantMap();
+    har["timings"] = timings;
+    har["_fromCache"] = fromCache;
+    if (reply->error() != QNetworkReply::NoError)
+        har["_error"] = reply->errorString();
+
+    return har;
+}
+
+QByteArray HarRecorder::toHar() const
+{
+    QVariantMap creator;
+    creator["name"] = "QtRUIBrowser";
+    creator["version"] = "1.0";
+
+    QVariantList entries;
+    foreach (const QVariantMap& entry, m_entries) {
+        entries.append(entry);
+    }
+
+    QVariantMap log;
+    log["version"] = "1.2";
+    log["creator"] = creator;
+    log["pages"] = QVariantList();
+    log["entries"] = entries;
+
+    QVariantMap har;
+    har["log"] = log;
+
+    return QJsonDocument::fromVariant(har).toJson();
+}
+
+bool HarRecorder::save(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "Unable to write %s\n", fileName.toUtf8().data());
+        return false;
+    }
+
+    file.write(toHar());
+    fprintf(stderr, "Wrote %d HAR entries to %s\n", m_entries.count(), fileName.toUtf8().data());
+    return true;
+}
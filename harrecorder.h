@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef HARRECORDER_H
+#define HARRECORDER_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QObject>
+
+class QNetworkReply;
+
+// The HarRecorder records the requests made through RUINetworkAccessManager (pages and
+// discovery) and exports them as an HTTP Archive (HAR 1.2), so a slow RUI can be looked at
+// without an external proxy. Nothing is tracked unless recording has been turned on.
+//
+// Qt doesn't report DNS, connect or TLS times, so those are -1 ("not available") and are
+// included in wait, which is the time until the response headers arrived.
+class HarRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    static HarRecorder* Instance();
+
+    bool isRecording() const { return m_recording; }
+    void setRecording(bool recording);
+    void clear();
+
+    void track(QNetworkReply* reply, QNetworkAccessManager::Operation op, const QNetworkRequest& request, qint64 requestBodySize);
+
+    QByteArray toHar() const;
+    bool save(const QString& fileName) const;
+
+private slots:
+    void onMetaDataChanged();
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onFinished();
+    void onDestroyed(QObject* object);
+
+private:
+    HarRecorder();
+    static HarRecorder* m_pInstance;
+
+    struct Entry {
+        QDateTime started;
+        QElapsedTimer clock;
+        QString method;
+        QNetworkRequest request;
+        qint64 requestBodySize;
+        qint64 firstByte;
+        qint64 bytesReceived;
+    };
+
+    QVariantMap harEntry(QNetworkReply* reply, const Entry& entry) const;
+
+    bool m_recording;
+    QHash<QObject*, Entry> m_pending;
+    QList<QVariantMap> m_entries;
+};
+
+#endif // HARRECORDER_H
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "homepage.h"
+#include "discoveryproxy.h"
+#include "tracerecorder.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QStringList>
+
+static const char* page_template = ":/www/index.html";
+static const char* nav_placeholder = "<div id=\"navUI\">Navigation Home Page</div>";
+static const char* missing_icon_url = "qrc:/www/rui_missingIcon.png";
+
+// Panel layout, as in rui.js (maxPanels, elementHeight).
+static const int MAX_PANELS = 4;
+static const int PANEL_TOP = 60;
+static const int ELEMENT_HEIGHT = 86;
+
+// Here to draw one face of a panel, the same markup as generateUIHtml() in rui.js.
+QString HomePage::panelHtml(const QVariantMap& ui, int index, int selectIndex, const QString& atlasURL)
+{
+    QString selected = (index == selectIndex) ? " selected" : "";
+
+    QString iconURL = ui.value("iconURL").toString();
+    if (iconURL.isEmpty()) {
+        QVariantList iconList = ui.value("iconList").toList();
+        iconURL = iconList.isEmpty() ? QString(missing_icon_url) : iconList.first().toMap().value("url").toString();
+    }
+
+    QString html;
+    html += "<div class='uiElementNumber" + selected + "'>";
+    html += QString::number((index + 1) % 10);
+    html += "</div>";
+
+    html += "<div class='uiElementName" + selected + "'>";
+    html += "<div class='uiElementIcon' style='padding-left:4; padding-top: 13;'>";
+    if (ui.contains("atlas")) {
+        QVariantMap atlas = ui.value("atlas").toMap();
+        html += QString("<div class='uiElementAtlasIcon' style='width: %1px; height: %2px; ")
+                .arg(atlas.value("width").toInt()).arg(atlas.value("height").toInt());
+        html += "background: url(" + atlasURL + ") ";
+        html += QString("-%1px -%2px no-repeat;'></div>").arg(atlas.value("x").toInt()).arg(atlas.value("y").toInt());
+    } else {
+        html += "<img src='" + iconURL.toHtmlEscaped() + "'/>";
+    }
+    html += "</div>";
+
+    html += "<div class='uiElementText'>";
+    html += ui.value("name").toString().toHtmlEscaped();
+    html += "</div>";
+    html += "</div>";
+
+    return html;
+}
+
+QByteArray HomePage::render(int scrollIndex, int screenIndex)
+{
+    TRACE_SCOPE("ui", "renderHomePage");
+
+    QFile file(page_template);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    QString page = QString::fromUtf8(file.readAll());
+
+    DiscoveryProxy* proxy = DiscoveryProxy::Instance();
+    QString atlasURL = proxy->iconAtlasURL();
+    int selectIndex = scrollIndex + screenIndex;
+
+    // The full list as rui.js would fetch it, so the page and its inline copy agree.
+    QVariantMap list = QJsonDocument::fromJson(proxy->ruiListDelta(0).toUtf8()).toVariant().toMap();
+
+    QMap<QString, QVariantMap> uis;
+    foreach (const QVariant& variant, list.value("changed").toList()) {
+        QVariantMap ui = variant.toMap();
+        uis.insert(ui.value("key").toString(), ui);
+    }
+    QVariantList keys = list.value("keys").toList();
+
+    // generatePage() in rui.js, with the panel faces loaded (loadPanelElements()).
+    QString nav = "<div id=\"navUI\">";
+    nav += "<div id='navHeader' class='arrowHidden' ></div>";
+
+    for (int i = 0; i < MAX_PANELS; i++) {
+        int index = scrollIndex + i;
+        QString stamp;
+        QString html;
+
+        if (index < keys.count()) {
+            QVariantMap ui = uis.value(keys[index].toString());
+            stamp = ui.value("key").toString() + "@" + QString::number(ui.value("revision").toInt()) + "#" + QString::number(index);
+            if (ui.contains("atlas"))
+                stamp += " " + atlasURL;
+            html = panelHtml(ui, index, selectIndex, atlasURL);
+        }
+
+        QString attributes = QString("style='top: %1px;' data-stamp=\"").arg(PANEL_TOP + i * ELEMENT_HEIGHT);
+        attributes += stamp.toHtmlEscaped() + "\">";
+
+        nav += QString("<div class='panel' onclick='selectPanel(%1)'>").arg(i);
+        nav += "<div class='uiElement front' " + attributes + html + "</div>";
+        nav += "<div class='uiElement back' " + attributes + html + "</div>";
+        nav += "</div>";
+    }
+
+    nav += "<div id='navFooter' class='arrowHidden' ></div>";
+    nav += "<div id='selectInstructions' >Select a Service</div>";
+    nav += "</div>";
+
+    QVariantMap home;
+    home["list"] = list;
+    home["atlasURL"] = atlasURL;
+    home["scrollIndex"] = scrollIndex;
+    home["screenIndex"] = screenIndex;
+    QString json = QString::fromUtf8(QJsonDocument::fromVariant(home).toJson(QJsonDocument::Compact));
+
+    // "</" would end the script element early.
+    nav += "<script type='text/javascript'>var ruiHome = " + json.replace("</", "<\\/") + ";</script>";
+
+    page.replace(nav_placeholder, nav);
+    return page.toUtf8();
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "hostlatency.h"
+#include "browsersettings.h"
+
+#include <stdio.h>
+
+// Bucket upper limits double from 50 ms; the last bucket is open ended.
+static const qint64 FIRST_BUCKET_MS = 50;
+
+// Weight of the newest sample in the EWMA.
+static const double EWMA_WEIGHT = 0.2;
+
+// Here to avoid deriving a timeout from a handful of loads; until then the ceiling is used.
+static const int MIN_SAMPLES = 5;
+
+// A timeout of twice the percentile load time leaves room for the occasional slow load.
+static const int TIMEOUT_HEADROOM = 2;
+
+// After first byte timeouts in a row, the deadline is doubled up to this many times (so at most
+// 4 x firstByteTimeoutMs), in case the server is only slow. A dead one is still caught quickly.
+static const int MAX_FIRST_BYTE_BACKOFF = 2;
+
+HostLatency* HostLatency::m_pInstance = NULL;
+
+HostLatency::Histogram::Histogram()
+    : count(0)
+    , ewma(0)
+{
+    for (int i = 0; i < BucketCount; i++) {
+        buckets[i] = 0;
+    }
+}
+
+qint64 HostLatency::bucketLimit(int bucket)
+{
+    return FIRST_BUCKET_MS << bucket;
+}
+
+void HostLatency::Histogram::add(qint64 ms)
+{
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && ms > bucketLimit(bucket)) {
+        bucket++;
+    }
+    buckets[bucket]++;
+
+    ewma = count ? (EWMA_WEIGHT * ms + (1 - EWMA_WEIGHT) * ewma) : ms;
+    count++;
+}
+
+// The upper limit of the bucket holding the percentile, so it errs on the long side.
+qint64 HostLatency::Histogram::percentile(int percent) const
+{
+    int target = (count * percent + 99) / 100;
+    int seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += buckets[i];
+        if (seen >= target)
+            return bucketLimit(i);
+    }
+    return bucketLimit(BucketCount - 1);
+}
+
+HostLatency::HostLatency()
+{
+}
+
+HostLatency* HostLatency::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new HostLatency;
+    }
+
+    return m_pInstance;
+}
+
+void HostLatency::record(const QString& host, qint64 loadMs, qint64 firstByteMs)
+{
+    Host& entry = m_hosts[host];
+    entry.load.add(loadMs);
+    if (firstByteMs >= 0) {
+        entry.firstByte.add(firstByteMs);
+        entry.firstByteTimeouts = 0;
+    }
+}
+
+// Counted apart from the first byte times: a host that never answers mustn't push its own
+// deadline up the way slow answers do.
+void HostLatency::recordFirstByteTimeout(const QString& host)
+{
+    m_hosts[host].firstByteTimeouts++;
+}
+
+int HostLatency::loadTimeout(const QString& host)
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+    int floor = settings->timeoutFloorSeconds * 1000;
+    int ceiling = settings->timeoutCeilingSeconds * 1000;
+
+    QHash<QString, Host>::const_iterator it = m_hosts.constFind(host);
+    if (it == m_hosts.constEnd() || it->load.count < MIN_SAMPLES)
+        return ceiling;
+
+    qint64 timeout = it->load.percentile(settings->timeoutPercentile) * TIMEOUT_HEADROOM;
+    return qBound(qint64(floor), timeout, qint64(ceiling));
+}
+
+// The configured deadline, unless this host is known to take longer to start responding. A host
+// that has just missed it gets a little longer (a slow server gets to answer, and from then on
+// its answers set the deadline), but never more than a few times the configured deadline.
+int HostLatency::firstByteTimeout(const QString& host)
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+    qint64 timeout = settings->firstByteTimeoutMs;
+
+    QHash<QString, Host>::const_iterator it = m_hosts.constFind(host);
+    if (it != m_hosts.constEnd()) {
+        if (it->firstByte.count >= MIN_SAMPLES)
+            timeout = qMax(timeout, it->firstByte.percentile(settings->timeoutPercentile) * TIMEOUT_HEADROOM);
+        if (it->firstByteTimeouts > 0)
+            timeout = qMax(timeout, qint64(settings->firstByteTimeoutMs) << qMin(it->firstByteTimeouts, MAX_FIRST_BYTE_BACKOFF));
+    }
+
+    return qMin(timeout, qint64(loadTimeout(host)));
+}
+
+void HostLatency::dump()
+{
+    fprintf(stderr, "Host latency (ms):\n");
+
+    QHashIterator<QString, Host> it(m_hosts);
+    while (it.hasNext()) {
+        it.next();
+        const Host& host = it.value();
+
+        fprintf(stderr, "%s: load timeout %d, first byte timeout %d (%d first byte timeouts in a row)\n",
+                it.key().toUtf8().data(), loadTimeout(it.key()), firstByteTimeout(it.key()), host.firstByteTimeouts);
+
+        const Histogram* histograms[] = { &host.load, &host.firstByte };
+        const char* names[] = { "load", "first byte" };
+        for (int h = 0; h < 2; h++) {
+            fprintf(stderr, "  %s: %d samples, EWMA %.0f\n", names[h], histograms[h]->count, histograms[h]->ewma);
+            for (int i = 0; i < BucketCount; i++) {
+                if (!histograms[h]->buckets[i])
+                    continue;
+                if (i < BucketCount - 1)
+                    fprintf(stderr, "    <= %6lld: %d\n", bucketLimit(i), histograms[h]->buckets[i]);
+                else
+                    fprintf(stderr, "     > %6lld: %d\n", bucketLimit(i - 1), histograms[h]->buckets[i]);
+            }
+        }
+    }
+}
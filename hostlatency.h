@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef HOSTLATENCY_H
+#define HOSTLATENCY_H
+
+#include <QHash>
+#include <QString>
+
+// The HostLatency keeps the page load and first byte times seen for each host, as an EWMA and a
+// histogram, and derives the page load timeouts from them: a slow server on a congested link
+// gets the time it usually needs, while a dead one is caught by the first byte deadline.
+class HostLatency
+{
+public:
+    static HostLatency* Instance();
+
+    // firstByteMs is -1 if the load didn't get that far.
+    void record(const QString& host, qint64 loadMs, qint64 firstByteMs);
+
+    // A load given up at the first byte deadline. Not a latency sample; see firstByteTimeout().
+    void recordFirstByteTimeout(const QString& host);
+
+    int loadTimeout(const QString& host);       // ms
+    int firstByteTimeout(const QString& host);  // ms
+
+    void dump();
+
+private:
+    HostLatency();
+    static HostLatency* m_pInstance;
+
+    enum { BucketCount = 12 };
+
+    struct Histogram {
+        Histogram();
+        void add(qint64 ms);
+        qint64 percentile(int percent) const;
+
+        int buckets[BucketCount];
+        int count;
+        double ewma;
+    };
+
+    struct Host {
+        Host() : firstByteTimeouts(0) {}
+        Histogram load;
+        Histogram firstByte;
+        int firstByteTimeouts;  // in a row, since the host last answered
+    };
+
+    static qint64 bucketLimit(int bucket);
+
+    QHash<QString, Host> m_hosts;
+};
+
+#endif // HOSTLATENCY_H
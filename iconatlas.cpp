@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "iconatlas.h"
+#include "iconcache.h"
+
+#include <QBuffer>
+#include <QPainter>
+#include <QtConcurrentRun>
+
+IconAtlas* IconAtlas::m_pInstance = NULL;
+
+const char* IconAtlas::atlasKey = "atlas";
+
+// Cell size matches the panel icon area (see IconCache). 8 x 32 cells keeps the atlas under
+// 5 MB decoded; UIs beyond that fall back to individual rui-icon:// images.
+static const int CELL_WIDTH = 80;
+static const int CELL_HEIGHT = 60;
+static const int COLUMNS = 8;
+static const int MAX_CELLS = COLUMNS * 32;
+
+// Icons tend to arrive in bursts; coalesce the resulting change notifications.
+static const int CHANGED_DELAY_MS = 250;
+
+// Runs on a worker thread.
+static QByteArray encodePng(const QImage& image)
+{
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return png;
+}
+
+IconAtlas::IconAtlas()
+    : m_cellCount(0)
+    , m_generation(0)
+    , m_pngGeneration(-1)
+    , m_encodeGeneration(-1)
+    , m_pngWanted(false)
+{
+    connect(&m_encodeWatcher, SIGNAL(finished()), this, SLOT(onEncodeFinished()));
+    m_changedTimer.setInterval(CHANGED_DELAY_MS);
+    m_changedTimer.setSingleShot(true);
+    connect(&m_changedTimer, SIGNAL(timeout()), this, SIGNAL(changed()));
+    connect(IconCache::Instance(), SIGNAL(iconReady(QString)), this, SLOT(onIconReady(QString)));
+}
+
+IconAtlas* IconAtlas::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new IconAtlas;
+    }
+
+    return m_pInstance;
+}
+
+QRect IconAtlas::cellRect(int index)
+{
+    return QRect((index % COLUMNS) * CELL_WIDTH, (index / COLUMNS) * CELL_HEIGHT, CELL_WIDTH, CELL_HEIGHT);
+}
+
+// Grow the atlas image a row at a time as cells are handed out.
+void IconAtlas::ensureRows(int index)
+{
+    int height = (index / COLUMNS + 1) * CELL_HEIGHT;
+    if (m_image.height() >= height)
+        return;
+
+    QImage image(COLUMNS * CELL_WIDTH, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    if (!m_image.isNull()) {
+        QPainter painter(&image);
+        painter.drawImage(0, 0, m_image);
+    }
+
+    m_image = image;
+}
+
+QVariantMap IconAtlas::acquire(const QString& key)
+{
+    QVariantMap map;
+
+    if (m_cells.contains(key)) {
+        m_cells[key].refCount++;
+    } else {
+        int index;
+        if (!m_freeCells.isEmpty()) {
+            index = m_freeCells.takeFirst();
+        } else if (m_cellCount < MAX_CELLS) {
+            index = m_cellCount++;
+            ensureRows(index);
+        } else {
+            return map;
+        }
+
+        Cell cell;
+        cell.index = index;
+        cell.refCount = 1;
+        m_cells.insert(key, cell);
+
+        // Reused cells still hold the previous icon, so always repaint.
+        paintCell(key, index);
+    }
+
+    QRect rect = cellRect(m_cells[key].index);
+    map["x"] = rect.x();
+    map["y"] = rect.y();
+    map["width"] = rect.width();
+    map["height"] = rect.height();
+    return map;
+}
+
+void IconAtlas::release(const QString& key)
+{
+    if (!m_cells.contains(key))
+        return;
+
+    Cell& cell = m_cells[key];
+    if (--cell.refCount > 0)
+        return;
+
+    // The pixels are left alone; nothing refers to the cell until it's handed out again.
+    m_freeCells.append(cell.index);
+    m_cells.remove(key);
+}
+
+void IconAtlas::paintCell(const QString& key, int index)
+{
+    QRect rect = cellRect(index);
+    QImage icon = IconCache::Instance()->iconImage(key);
+
+    QPainter painter(&m_image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(rect, Qt::transparent);
+    if (!icon.isNull()) {
+        // Centred in the cell; icons are scaled to fit it, so most are narrower or shorter.
+        QPoint offset((rect.width() - icon.width()) / 2, (rect.height() - icon.height()) / 2);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.drawImage(rect.topLeft() + offset, icon);
+    }
+    painter.end();
+
+    m_generation++;
+    m_changedTimer.start();
+}
+
+void IconAtlas::onIconReady(const QString& key)
+{
+    if (m_cells.contains(key))
+        paintCell(key, m_cells[key].index);
+}
+
+QString IconAtlas::url()
+{
+    return QString("rui-icon://%1/%2").arg(atlasKey).arg(m_generation);
+}
+
+void IconAtlas::trimMemory()
+{
+    m_png = QByteArray();
+    m_pngGeneration = -1;
+}
+
+// Encoded lazily, once per generation that is actually requested.
+bool IconAtlas::png(QByteArray* data)
+{
+    if (m_pngGeneration == m_generation) {
+        *data = m_png;
+        return true;
+    }
+
+    m_pngWanted = true;
+    encode();
+    return false;
+}
+
+// The image is shared with the worker; painting a cell meanwhile detaches our copy.
+void IconAtlas::encode()
+{
+    if (m_encodeWatcher.isRunning())
+        return;
+
+    m_encodeGeneration = m_generation;
+    m_encodeWatcher.setFuture(QtConcurrent::run(encodePng, m_image));
+}
+
+void IconAtlas::onEncodeFinished()
+{
+    m_png = m_encodeWatcher.result();
+    m_pngGeneration = m_encodeGeneration;
+
+    // Repainted while encoding: the requests are for the newer generation, so encode again.
+    if (m_pngGeneration != m_generation) {
+        encode();
+        return;
+    }
+
+    if (m_pngWanted) {
+        m_pngWanted = false;
+        emit pngReady(m_png);
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QMap>
+#include <QRect>
+#include <QList>
+#include <QTimer>
+#include <QVariantMap>
+
+// The IconAtlas packs the (pre-scaled) icons of all current UIs into a single image, so the
+// navigation page can render every panel from one request and one decode. Each icon gets a fixed
+// cell for as long as any UI refers to it; cells are painted as icons become available and are
+// reused once released, so the atlas is updated incrementally rather than rebuilt.
+//
+// The atlas is served as rui-icon://atlas/<generation>; the generation changes whenever a cell
+// is repainted, so the page never renders a stale copy. The PNG is encoded on a worker thread,
+// only for the generations that are actually requested.
+class IconAtlas : public QObject
+{
+    Q_OBJECT
+
+public:
+    static IconAtlas* Instance();
+
+    // Reference counted cell allocation for an IconCache key. acquire() returns the cell
+    // rectangle (x, y, width, height) or an empty map if the atlas is full.
+    QVariantMap acquire(const QString& key);
+    void release(const QString& key);
+
+    QString url();
+
+    // Encoded atlas of the current generation, or false if it isn't encoded yet; then it's
+    // encoded in the background, and pngReady() hands it out.
+    bool png(QByteArray* data);
+
+    // Drops the encoded copy of the atlas; it is encoded again on the next request.
+    void trimMemory();
+    QImage image() { return m_image; }
+
+    static const char* atlasKey;
+
+signals:
+    void changed();
+    void pngReady(const QByteArray& png);
+
+private slots:
+    void onIconReady(const QString& key);
+    void onEncodeFinished();
+
+private:
+    IconAtlas();
+    static IconAtlas* m_pInstance;
+
+    struct Cell {
+        int index;
+        int refCount;
+    };
+
+    QRect cellRect(int index);
+    void paintCell(const QString& key, int index);
+    void ensureRows(int index);
+    void encode();
+
+    QImage m_image;
+    QMap<QString, Cell> m_cells;
+    QList<int> m_freeCells;
+    int m_cellCount;
+    int m_generation;
+    QByteArray m_png;
+    int m_pngGeneration;
+    QFutureWatcher<QByteArray> m_encodeWatcher;
+    int m_encodeGeneration;
+    bool m_pngWanted;
+    QTimer m_changedTimer;
+};
+
+#endif // ICONATLAS_H
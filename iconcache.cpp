@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "iconcache.h"
+#include "browsersettings.h"
+
+#include <stdio.h>
+#include <utime.h>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QtConcurrentRun>
+
+IconCache* IconCache::m_pInstance = NULL;
+
+// Size of the icon area of a navigation panel (see .uiElementIcon img in rui.css)
+static const int PANEL_ICON_WIDTH = 80;
+static const int PANEL_ICON_HEIGHT = 60;
+
+static const char* icon_scheme = "rui-icon";
+
+// Result of a background decode.
+struct DecodedIcon {
+    QString key;
+    QImage image;
+    QByteArray png;
+    bool fromDisk;
+};
+
+// Runs on a worker thread: decode the downloaded icon, scale it to the panel and re-encode it.
+static DecodedIcon decodeIcon(const QString& key, const QByteArray& data)
+{
+    DecodedIcon result;
+    result.key = key;
+    result.fromDisk = false;
+
+    QImage image;
+    if (!image.loadFromData(data))
+        return result;
+
+    // The panel shows icons scaled to fit, up or down (see rui.css). Do that once, here.
+    QSize panelSize = image.size().scaled(PANEL_ICON_WIDTH, PANEL_ICON_HEIGHT, Qt::KeepAspectRatio);
+    if (image.size() != panelSize) {
+        image = image.scaled(panelSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    result.image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QBuffer buffer(&result.png);
+    buffer.open(QIODevice::WriteOnly);
+    result.image.save(&buffer, "PNG");
+
+    return result;
+}
+
+// Runs on a worker thread: read an icon from the disk cache. The image is null if it isn't there.
+static DecodedIcon readIcon(const QString& key, const QString& path)
+{
+    DecodedIcon result;
+    result.key = key;
+    result.fromDisk = true;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    QByteArray png = file.readAll();
+    QImage image;
+    if (!image.loadFromData(png, "PNG"))
+        return result;
+
+    // Touch the file, so the disk cache is pruned least recently used first.
+    utime(QFile::encodeName(path).constData(), NULL);
+
+    result.image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    result.png = png;
+    return result;
+}
+
+IconCache::IconCache()
+    : m_http(this)
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+
+    m_memoryCache.setMaxCost(settings->iconMemoryCacheKB * 1024);
+    m_diskDirectory = settings->iconCacheDirectory;
+    m_diskBudget = qint64(settings->iconDiskCacheKB) * 1024;
+
+    if (!m_diskDirectory.isEmpty())
+        QDir().mkpath(m_diskDirectory);
+
+    connect(&m_http, SIGNAL(finished(QNetworkReply*)), this, SLOT(httpReply(QNetworkReply*)));
+}
+
+IconCache* IconCache::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new IconCache;
+    }
+
+    return m_pInstance;
+}
+
+// Best size match for a panel: the smallest icon that covers the panel (so we only ever scale
+// down), otherwise the largest one available. Ties go to the deeper icon.
+const RUIIcon* IconCache::selectIcon(const QList<RUIIcon>& iconList)
+{
+    const RUIIcon* best = 0;
+    int bestArea = 0;
+    int bestDepth = 0;
+    bool bestCovers = false;
+
+    for (int i = 0; i < iconList.count(); i++) {
+        const RUIIcon& icon = iconList[i];
+        int width = icon.m_width.toInt();
+        int height = icon.m_height.toInt();
+        int depth = icon.m_depth.toInt();
+        int area = width * height;
+        bool covers = (width >= PANEL_ICON_WIDTH && height >= PANEL_ICON_HEIGHT);
+
+        bool better;
+        if (!best)
+            better = true;
+        else if (covers != bestCovers)
+            better = covers;
+        else if (area != bestArea)
+            better = covers ? (area < bestArea) : (area > bestArea);
+        else
+            better = depth > bestDepth;
+
+        if (better) {
+            best = &icon;
+            bestArea = area;
+            bestDepth = depth;
+            bestCovers = covers;
+        }
+    }
+
+    return best;
+}
+
+QString IconCache::keyForURL(const QUrl& url)
+{
+    return url.host();
+}
+
+QString IconCache::iconURL(const QList<RUIIcon>& iconList)
+{
+    const RUIIcon* icon = selectIcon(iconList);
+    if (!icon)
+        return "qrc:/www/rui_missingIcon.png";
+
+    // Bundled icons are local already.
+    if (icon->m_url.startsWith("qrc:"))
+        return icon->m_url;
+
+    QString key = QCryptographicHash::hash(icon->m_url.toUtf8(), QCryptographicHash::Md5).toHex();
+    m_sourceURLs.insert(key, icon->m_url);
+
+    // Start fetching in the background, so the icon is ready by the time the page asks for it.
+    fetch(key);
+
+    return QString("%1://%2").arg(icon_scheme).arg(key);
+}
+
+bool IconCache::iconData(const QString& key, QByteArray* data)
+{
+    Entry* entry = m_memoryCache.object(key);
+    if (!entry)
+        return false;
+
+    *data = entry->png;
+    return true;
+}
+
+QImage IconCache::iconImage(const QString& key)
+{
+    Entry* entry = m_memoryCache.object(key);
+    return entry ? entry->image : QImage();
+}
+
+// The disk cache is tried first, then the network. Either way the icon is decoded on a worker
+// thread and reported by iconReady() or iconFailed().
+void IconCache::fetch(const QString& key)
+{
+    if (m_pending.contains(key) || m_memoryCache.contains(key))
+        return;
+
+    m_pending.insert(key, true);
+
+    if (m_diskDirectory.isEmpty()) {
+        download(key);
+    } else {
+        decode(QtConcurrent::run(readIcon, key, diskPath(key)));
+    }
+}
+
+void IconCache::download(const QString& key)
+{
+    if (!m_sourceURLs.contains(key)) {
+        m_pending.remove(key);
+        emit iconFailed(key);
+        return;
+    }
+
+    QNetworkRequest request(QUrl(m_sourceURLs[key]));
+    request.setAttribute(QNetworkRequest::User, key);
+    m_http.get(request);
+}
+
+void IconCache::clearMemoryCache()
+{
+    m_memoryCache.clear();
+}
+
+void IconCache::httpReply(QNetworkReply* reply)
+{
+    reply->deleteLater();
+
+    QString key = reply->request().attribute(QNetworkRequest::User).toString();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fprintf(stderr, "IconCache::httpReply: %s - %s\n",
+                reply->url().toString().toUtf8().data(), reply->errorString().toUtf8().data());
+        m_pending.remove(key);
+        emit iconFailed(key);
+        return;
+    }
+
+    decode(QtConcurrent::run(decodeIcon, key, reply->readAll()));
+}
+
+void IconCache::decode(const QFuture<DecodedIcon>& future)
+{
+    QFutureWatcher<DecodedIcon>* watcher = new QFutureWatcher<DecodedIcon>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(decodeFinished()));
+    watcher->setFuture(future);
+}
+
+// Back on the main thread with a decoded icon.
+void IconCache::decodeFinished()
+{
+    QFutureWatcher<DecodedIcon>* watcher = static_cast<QFutureWatcher<DecodedIcon>*>(sender());
+    DecodedIcon decoded = watcher->result();
+    watcher->deleteLater();
+
+    // Not in the disk cache (or unreadable), so go to the network; it stays pending.
+    if (decoded.image.isNull() && decoded.fromDisk) {
+        download(decoded.key);
+        return;
+    }
+
+    m_pending.remove(decoded.key);
+
+    if (decoded.image.isNull()) {
+        fprintf(stderr, "IconCache: unable to decode %s\n", m_sourceURLs.value(decoded.key).toUtf8().data());
+        emit iconFailed(decoded.key);
+        return;
+    }
+
+    insert(decoded.key, decoded.image, decoded.png);
+    if (!decoded.fromDisk)
+        storeToDisk(decoded.key, decoded.png);
+
+    emit iconReady(decoded.key);
+}
+
+void IconCache::insert(const QString& key, const QImage& image, const QByteArray& png)
+{
+    Entry* entry = new Entry;
+    entry->image = image;
+    entry->png = png;
+
+    // Cost is what we hold in memory: the decoded pixels plus the encoded copy.
+    m_memoryCache.insert(key, entry, image.byteCount() + png.size());
+}
+
+QString IconCache::diskPath(const QString& key)
+{
+    return m_diskDirectory + "/" + key + ".png";
+}
+
+void IconCache::storeToDisk(const QString& key, const QByteArray& png)
+{
+    if (m_diskDirectory.isEmpty())
+        return;
+
+    QFile file(diskPath(key));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(png);
+        file.close();
+        pruneDiskCache();
+    }
+}
+
+void IconCache::pruneDiskCache()
+{
+    QDir dir(m_diskDirectory);
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.png", QDir::Files, QDir::Time);
+
+    qint64 total = 0;
+    foreach (const QFileInfo& info, files) {
+        total += info.size();
+    }
+
+    // Sorted newest first, so remove from the back.
+    while (total > m_diskBudget && !files.isEmpty()) {
+        QFileInfo oldest = files.takeLast();
+        total -= oldest.size();
+        QFile::remove(oldest.absoluteFilePath());
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QMap>
+#include <QImage>
+#include <QByteArray>
+#include <QNetworkAccessManager>
+#include <QFutureWatcher>
+
+#include "userinterfacemap.h"
+
+struct DecodedIcon;
+
+// The IconCache fetches RUI icons in the background, decodes and scales them to the navigation
+// panel size off the main thread, and keeps the result in a memory and disk LRU. Icons found in
+// the disk cache are read and decoded off the main thread as well; until then, and until a
+// fetch completes, an icon isn't available and iconReady() reports it later. The navigation
+// page refers to icons through rui-icon:// URLs (see iconURL()), which RUINetworkAccessManager
+// serves from here, so rendering the home page never goes to the network for an icon.
+class IconCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static IconCache* Instance();
+
+    // Pick the icon that best fits a navigation panel, register it, and return the URL the
+    // navigation page should use for it. Starts fetching the icon if it isn't cached yet.
+    QString iconURL(const QList<RUIIcon>& iconList);
+    static const RUIIcon* selectIcon(const QList<RUIIcon>& iconList);
+
+    // Scaled PNG for a registered icon key, or false if it isn't in memory (yet; see fetch()).
+    bool iconData(const QString& key, QByteArray* data);
+    QImage iconImage(const QString& key);
+    void fetch(const QString& key);
+
+    void clearMemoryCache();
+
+    static QString keyForURL(const QUrl& url);
+
+signals:
+    void iconReady(const QString& key);
+    void iconFailed(const QString& key);
+
+private slots:
+    void httpReply(QNetworkReply*);
+    void decodeFinished();
+
+private:
+    IconCache();
+    static IconCache* m_pInstance;
+
+    struct Entry {
+        QImage image;
+        QByteArray png;
+    };
+
+    QString diskPath(const QString& key);
+    void download(const QString& key);
+    void decode(const QFuture<DecodedIcon>& future);
+    void storeToDisk(const QString& key, const QByteArray& png);
+    void pruneDiskCache();
+    void insert(const QString& key, const QImage& image, const QByteArray& png);
+
+    QNetworkAccessManager m_http;
+    QCache<QString, Entry> m_memoryCache;
+    QMap<QString, QString> m_sourceURLs;  // key -> remote icon URL
+    QMap<QString, bool> m_pending;        // keys being fetched or decoded
+    QString m_diskDirectory;
+    qint64 m_diskBudget;
+};
+
+#endif // ICONCACHE_H
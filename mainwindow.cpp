@@ -29,14 +29,30 @@
 #include "browsersettings.h"
 #include "utils.h"
 #include "ruiwebpage.h"
+#include "bridgebenchmark.h"
+#include "pageloadtimings.h"
+#include "harrecorder.h"
+#include "tracerecorder.h"
+#include "ruinetworkaccessmanager.h"
+#include "hostlatency.h"
+#include "memorygovernor.h"
+#include "memorypressuremonitor.h"
+#include "startuptrace.h"
+#include "ruilistmodel.h"
+#include "navigationview.h"
+#include "navigationbridge.h"
+#include "ruiprocesshost.h"
+#include "ruiprefetcher.h"
 
 // Temp
 //#include "discoverystub.h"
 
 #include <QMenuBar>
+#include <QFile>
 #include <QFileDialog>
 #include <QKeyEvent>
 #include <QAction>
+#include <QActionGroup>
 #include <QSplitter>
 #include <QWebView>
 #include <QWebPage>
@@ -45,48 +61,81 @@
 #include <QTimer>
 #include <QFrame>
 #include <QNetworkProxy>
+#include <QVector>
+#include <QtAlgorithms>
+#include <stdio.h>
 
 #define TV_REMOTE_SIMULATOR 1
 
 static const int DEFAULT_HEIGHT = 700;
 static const int DEFAULT_WIDTH = 1000;
 
-const char* rui_home = "qrc:/www/index.html";
+// The spare page is created once the event loop has been idle for a moment, so it doesn't
+// compete with startup or with the load that just consumed the previous spare.
+static const int SPARE_PAGE_DELAY_MS = 1000;
+
+// Time given to the navigation page (and spare page) before a --benchmark-launch load.
+static const int BENCHMARK_LAUNCH_DELAY_MS = 3000;
+
+// Discovery starts after the first paint of the navigation page, or after this long.
+static const int DISCOVERY_START_TIMEOUT_MS = 3000;
+
+// Key presses sent to the navigation screen by the key latency benchmark.
+static const int NAVIGATION_BENCHMARK_KEYS = 200;
+
+const char* rui_home = "rui:home";
 
 MainWindow::MainWindow(bool startFullScreen)
     : m_page(0)
+    , m_navigationModel(0)
+    , m_navigationView(0)
+    , m_prerenderPage(0)
+    , m_sparePage(0)
+    , m_processHost(0)
+    , m_processShowing(false)
     , m_navigationBar(0)
+    , m_viewMenu(0)
+    , m_debugMenu(0)
+    , m_inspectorAction(0)
     , m_urlEdit(0)
     , m_discoveryProxy(0)
+    , m_navigationBridge(0)
     , m_browserSettings(BrowserSettings::Instance())
+    , m_splitter(0)
+    , m_inspector(0)
+    , m_homeLaidOut(false)
+    , m_homePainted(false)
+    , m_benchmarkStartup(false)
 {
+    StartupTrace::mark("main window construction started");
+
     if (startFullScreen)
         m_browserSettings->startFullScreen = true;
 
     // We house the RUI webview and the web inspector in a splitter.
-    QSplitter* splitter = new QSplitter(Qt::Vertical, this);
-    setCentralWidget(splitter);
-    splitter->setMinimumWidth(800);
-    splitter->setMinimumHeight(450);
-    splitter->resize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
-
-    // RUI webview
-    m_page = new RUIWebPage(this);
-    m_view = new QWebView(splitter);
+    m_splitter = new QSplitter(Qt::Vertical, this);
+    setCentralWidget(m_splitter);
+    m_splitter->setMinimumWidth(800);
+    m_splitter->setMinimumHeight(450);
+    m_splitter->resize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+
+    // RUI webview. The navigation page lives in its own page, which stays loaded for the lifetime
+    // of the window and is swapped in and out of the view.
+    m_homePage = new RUIWebPage(this);
+    m_page = m_homePage;
+    m_view = new QWebView(m_splitter);
     m_view->setPage(m_page);
     m_view->installEventFilter(this);
     m_view->resize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+    StartupTrace::mark("web view created");
 
-    m_inspector = new WebInspector;
-    connect(this, SIGNAL(destroyed()), m_inspector, SLOT(deleteLater()));
-
-    splitter->addWidget(m_inspector);
-    m_inspector->setPage(m_page);
-    if (!m_browserSettings->hasWebInspector) {
-        m_inspector->hide();
+    // The web inspector is only created when it is first shown.
+    if (m_browserSettings->hasWebInspector) {
+        inspector()->show();
     }
 
     buildUI();
+    StartupTrace::mark("menus and navigation bar built");
 
     // Process window settings
     Qt::WindowFlags flags = this->windowFlags();
@@ -110,14 +159,143 @@ MainWindow::MainWindow(bool startFullScreen)
         fullScreen(true);
     }
 
-    // Discovery Proxy
+    // Discovery Proxy. Discovery itself is started once the navigation page is on screen.
     m_discoveryProxy = DiscoveryProxy::Instance();
+    m_discoveryProxy->setPreconnectManager(m_page->networkAccessManager());
+    m_navigationBridge = new NavigationBridge(m_discoveryProxy, this);
+    m_homePage->setProperty(navigation_bridge_property, QVariant::fromValue<QObject*>(m_navigationBridge));
+    StartupTrace::mark("discovery proxy created");
 
     // Connect proxy load signals
-    attachProxyObject();
-    connect(m_page->mainFrame(), SIGNAL(loadStarted()), this, SLOT(onLoadStarted()));
+    connect(m_homePage->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()), this, SLOT(onJavaScriptWindowObjectCleared()));
+    connectPage(m_page);
     connect(m_view, SIGNAL(loadFinished(bool)), this, SLOT(onPageLoaded(bool)));
-    connect(m_page->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()), this, SLOT(onJavaScriptWindowObjectCleared()));
+    connect(m_navigationBridge, SIGNAL(uiSelected(QString)), this, SLOT(onUISelected(QString)));
+    connect(m_navigationBridge, SIGNAL(uiHighlighted(QString)), this, SLOT(onUIHighlighted(QString)));
+    connect(MemoryPressureMonitor::Instance(), SIGNAL(tierApplied(int)), this, SLOT(onMemoryPressureTier(int)));
+
+    // RUIs in a child process. The first child is started at idle, like the spare page.
+    if (m_browserSettings->processPerRUI) {
+        m_processHost = new RUIProcessHost(m_splitter, this);
+        connect(m_processHost, SIGNAL(containerChanged(QWidget*)), this, SLOT(onProcessContainerChanged(QWidget*)));
+        connect(m_processHost, SIGNAL(homeRequested()), this, SLOT(onProcessHomeRequested()));
+        connect(m_processHost, SIGNAL(titleChanged(QString)), this, SLOT(onTitleChanged(QString)));
+        connect(m_processHost, SIGNAL(urlChanged(QUrl)), this, SLOT(setAddressUrl(QUrl)));
+        QTimer::singleShot(SPARE_PAGE_DELAY_MS, m_processHost, SLOT(start()));
+    }
+
+    // Prerender of the highlighted RUI, once the selection has settled.
+    m_prerenderTimer.setSingleShot(true);
+    m_prerenderTimer.setInterval(m_browserSettings->prerenderDwellMs);
+    connect(&m_prerenderTimer, SIGNAL(timeout()), this, SLOT(startPrerender()));
+
+    if (m_browserSettings->nativeNavigation) {
+        // Native navigation screen. The navigation page is never loaded; its (empty) page stays
+        // in the hidden web view while the screen is showing.
+        m_navigationModel = new RUIListModel(m_navigationBridge, this);
+        m_navigationView = new NavigationView(m_navigationModel, m_navigationBridge);
+        m_navigationView->installEventFilter(this);
+        m_splitter->insertWidget(0, m_navigationView);
+        m_view->hide();
+        m_navigationView->setFocus();
+        m_homeLaidOut = true;
+        StartupTrace::mark("native navigation screen created");
+    } else {
+        connect(m_homePage->mainFrame(), SIGNAL(initialLayoutCompleted()), this, SLOT(onHomeLayoutCompleted()));
+        m_homePage->mainFrame()->load(QUrl(rui_home));
+        StartupTrace::mark("navigation page load started");
+    }
+
+    // In case the navigation page never gets painted (e.g. the window isn't shown).
+    QTimer::singleShot(DISCOVERY_START_TIMEOUT_MS, this, SLOT(startDiscovery()));
+
+    scheduleSparePage();
+}
+
+// Here to switch between the child process's RUI and the navigation screen. The navigation
+// screen stands in while there is no child window (the child is starting or being restarted).
+void MainWindow::showProcessView(bool on)
+{
+    m_processShowing = on;
+
+    QWidget* homeView = m_navigationView ? (QWidget*)m_navigationView : (QWidget*)m_view;
+    QWidget* container = m_processHost->container();
+
+    if (container)
+        container->setVisible(on);
+    homeView->setVisible(!on || !container);
+
+    if (on && container)
+        container->setFocus();
+    else
+        homeView->setFocus();
+}
+
+// Here when the child process's window was embedded, or went away with the child.
+void MainWindow::onProcessContainerChanged(QWidget* container)
+{
+    if (container) {
+        m_splitter->insertWidget(0, container);
+        container->installEventFilter(this);
+    }
+
+    if (m_processShowing) {
+        showProcessView(true);
+    } else if (container) {
+        container->hide();
+    }
+}
+
+void MainWindow::onProcessHomeRequested()
+{
+    home();
+}
+
+WebInspector* MainWindow::inspector()
+{
+    if (!m_inspector) {
+        m_inspector = new WebInspector;
+        connect(this, SIGNAL(destroyed()), m_inspector, SLOT(deleteLater()));
+
+        m_splitter->addWidget(m_inspector);
+        m_inspector->setPage(m_page);
+        m_inspector->hide();
+
+        if (m_inspectorAction)
+            m_inspectorAction->connect(m_inspector, SIGNAL(visibleChanged(bool)), SLOT(setChecked(bool)));
+    }
+
+    return m_inspector;
+}
+
+void MainWindow::startDiscovery()
+{
+    m_discoveryProxy->startDiscovery();
+}
+
+void MainWindow::onHomeLayoutCompleted()
+{
+    m_homeLaidOut = true;
+}
+
+// Here on the first paint of the navigation page, with content: the end of startup.
+void MainWindow::onHomePainted()
+{
+    StartupTrace::mark("first navigation page paint");
+
+    QTimer::singleShot(0, this, SLOT(startDiscovery()));
+
+    if (m_benchmarkStartup) {
+        fprintf(stderr, "Benchmark: first navigation page paint at %lld ms\n", StartupTrace::elapsed());
+        QTimer::singleShot(0, QApplication::instance(), SLOT(quit()));
+    }
+}
+
+// Startup benchmark (--benchmark-startup): report the time to the first paint of the navigation
+// page, then exit.
+void MainWindow::benchmarkStartup()
+{
+    m_benchmarkStartup = true;
 }
 
 void MainWindow::buildUI()
@@ -144,9 +322,7 @@ void MainWindow::buildUI()
     }
 
     if (m_browserSettings->hasReloadButton) {
-        QAction* reloadAction = m_page->action(QWebPage::Reload);
-        connect(reloadAction, SIGNAL(triggered()), this, SLOT(changeLocation()));
-        m_navigationBar->addAction(reloadAction);
+        m_navigationBar->addAction(m_page->action(QWebPage::Reload));
     }
 
     if (!m_browserSettings->hasHomeButton) {
@@ -161,35 +337,110 @@ void MainWindow::buildUI()
         m_urlEdit->setCompleter(completer);
         completer->setModel(&m_urlModel);
         m_navigationBar->addWidget(m_urlEdit);
-
-        connect(m_page->mainFrame(), SIGNAL(urlChanged(QUrl)), this, SLOT(setAddressUrl(QUrl)));
-        connect(m_page, SIGNAL(loadProgress(int)), m_urlEdit, SLOT(setProgress(int)));
-        connect(m_page->mainFrame(), SIGNAL(iconChanged()), this, SLOT(onIconChanged()));
     }
 
     if (!m_browserSettings->hasNavigationBar) {
         m_navigationBar->hide();
     }
+}
 
+// Here to connect the signals of the page shown in the view. See setPage().
+void MainWindow::connectPage(RUIWebPage* page)
+{
+    connect(page->mainFrame(), SIGNAL(loadStarted()), this, SLOT(onLoadStarted()), Qt::UniqueConnection);
+
+    if (m_browserSettings->hasReloadButton) {
+        connect(page->action(QWebPage::Reload), SIGNAL(triggered()), this, SLOT(changeLocation()), Qt::UniqueConnection);
+    }
+
+    if (m_browserSettings->hasUrlEdit) {
+        connect(page->mainFrame(), SIGNAL(urlChanged(QUrl)), this, SLOT(setAddressUrl(QUrl)), Qt::UniqueConnection);
+        connect(page, SIGNAL(loadProgress(int)), m_urlEdit, SLOT(setProgress(int)), Qt::UniqueConnection);
+        connect(page->mainFrame(), SIGNAL(iconChanged()), this, SLOT(onIconChanged()), Qt::UniqueConnection);
+    }
 
     if (m_browserSettings->hasTitleBar) {
-        connect(m_page->mainFrame(), SIGNAL(titleChanged(QString)), this, SLOT(onTitleChanged(QString)));
+        connect(page->mainFrame(), SIGNAL(titleChanged(QString)), this, SLOT(onTitleChanged(QString)), Qt::UniqueConnection);
     }
 
     // Not sure what this does
-    connect(m_page, SIGNAL(windowCloseRequested()), this, SLOT(close()));
+    connect(page, SIGNAL(windowCloseRequested()), this, SLOT(close()), Qt::UniqueConnection);
 
 #ifndef QT_NO_SHORTCUT
     // short-cuts
-    m_page->action(QWebPage::Back)->setShortcut(QKeySequence::Back);
-    m_page->action(QWebPage::Stop)->setShortcut(Qt::Key_Escape);
-    m_page->action(QWebPage::Forward)->setShortcut(QKeySequence::Forward);
-    m_page->action(QWebPage::Reload)->setShortcut(QKeySequence::Refresh);
+    page->action(QWebPage::Back)->setShortcut(QKeySequence::Back);
+    page->action(QWebPage::Stop)->setShortcut(Qt::Key_Escape);
+    page->action(QWebPage::Forward)->setShortcut(QKeySequence::Forward);
+    page->action(QWebPage::Reload)->setShortcut(QKeySequence::Refresh);
 
     // TODO: Home key shortcut
 #endif
 }
 
+void MainWindow::disconnectPage(RUIWebPage* page)
+{
+    disconnect(page->mainFrame(), SIGNAL(loadStarted()), this, SLOT(onLoadStarted()));
+    disconnect(page->action(QWebPage::Reload), 0, this, 0);
+    disconnect(page->mainFrame(), SIGNAL(urlChanged(QUrl)), this, SLOT(setAddressUrl(QUrl)));
+    disconnect(page->mainFrame(), SIGNAL(iconChanged()), this, SLOT(onIconChanged()));
+    disconnect(page->mainFrame(), SIGNAL(titleChanged(QString)), this, SLOT(onTitleChanged(QString)));
+    disconnect(page, SIGNAL(windowCloseRequested()), this, SLOT(close()));
+    if (m_urlEdit) {
+        disconnect(page, 0, m_urlEdit, 0);
+    }
+}
+
+// Here to show a different page in the view. The navigation bar and View menu use the page's
+// own actions, so those are swapped along with the signal connections. The caller owns the
+// previous page.
+void MainWindow::setPage(RUIWebPage* page)
+{
+    if (page == m_page)
+        return;
+
+    static const QWebPage::WebAction pageActions[] = { QWebPage::Back, QWebPage::Stop, QWebPage::Forward, QWebPage::Reload };
+
+    RUIWebPage* oldPage = m_page;
+    disconnectPage(oldPage);
+
+    for (unsigned i = 0; i < sizeof(pageActions) / sizeof(pageActions[0]); i++) {
+        QAction* oldAction = oldPage->action(pageActions[i]);
+        QAction* newAction = page->action(pageActions[i]);
+        QList<QWidget*> widgets;
+        widgets << m_navigationBar << m_viewMenu;
+        foreach (QWidget* widget, widgets) {
+            if (widget && widget->actions().contains(oldAction)) {
+                widget->insertAction(oldAction, newAction);
+                widget->removeAction(oldAction);
+            }
+        }
+    }
+
+    m_page = page;
+    m_view->setPage(m_page);
+    if (m_inspector)
+        m_inspector->setPage(m_page);
+    connectPage(m_page);
+
+    m_discoveryProxy->setPreconnectManager(m_page->networkAccessManager());
+    setAddressUrl(m_page->mainFrame()->url());
+
+    // With the native navigation screen, the web view only shows RUIs.
+    if (m_navigationView) {
+        bool home = (m_page == m_homePage);
+        m_navigationView->setVisible(home);
+        m_view->setVisible(!home);
+        if (home)
+            m_navigationView->setFocus();
+        else
+            m_view->setFocus();
+    }
+
+    if (m_browserSettings->hasTitleBar) {
+        onTitleChanged(m_page->mainFrame()->title());
+    }
+}
+
 void MainWindow::createMenuBar()
 {
     QMenu* fileMenu = menuBar()->addMenu("&File");
@@ -200,29 +451,74 @@ void MainWindow::createMenuBar()
     fileMenu->addSeparator();
     fileMenu->addAction("Quit", QApplication::instance(), SLOT(closeAllWindows()), QKeySequence(Qt::CTRL | Qt::Key_Q));
 
-    QMenu* viewMenu = menuBar()->addMenu("&View");
-    viewMenu->addAction(m_page->action(QWebPage::Stop));
-    viewMenu->addAction(m_page->action(QWebPage::Reload));
-    viewMenu->addAction("Full Screen", this, SLOT(fullScreenOn()));
-    viewMenu->addSeparator();
-    QAction* showNavigationBar = viewMenu->addAction("Navigation Bar", this, SLOT(toggleNavigationBar(bool)));
+    m_viewMenu = menuBar()->addMenu("&View");
+    m_viewMenu->addAction(m_page->action(QWebPage::Stop));
+    m_viewMenu->addAction(m_page->action(QWebPage::Reload));
+    m_viewMenu->addAction("Full Screen", this, SLOT(fullScreenOn()));
+    m_viewMenu->addSeparator();
+    QAction* showNavigationBar = m_viewMenu->addAction("Navigation Bar", this, SLOT(toggleNavigationBar(bool)));
     showNavigationBar->setCheckable(true);
     showNavigationBar->setChecked(m_browserSettings->hasNavigationBar);
 
-    QMenu* debugMenu = menuBar()->addMenu("&Debug");
-    debugMenu->addAction("Dump User Interface Map", this, SLOT(dumpUserInterfaceMap()));
-    debugMenu->addSeparator();
-    debugMenu->addAction("Dump HTML", this, SLOT(dumpHtml()));
+    // The debug menu is filled in when it is first opened; only the web inspector (which has a
+    // shortcut) is there from the start.
+    m_debugMenu = menuBar()->addMenu("&Debug");
+    connect(m_debugMenu, SIGNAL(aboutToShow()), this, SLOT(populateDebugMenu()));
+    m_inspectorAction = m_debugMenu->addAction("Web Inspector", this, SLOT(toggleWebInspector(bool)), QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_I));
+    m_inspectorAction->setCheckable(true);
+    if (m_inspector) {
+        m_inspectorAction->setChecked(m_inspector->isVisible());
+        m_inspectorAction->connect(m_inspector, SIGNAL(visibleChanged(bool)), SLOT(setChecked(bool)));
+    }
+}
+
+void MainWindow::populateDebugMenu()
+{
+    disconnect(m_debugMenu, SIGNAL(aboutToShow()), this, SLOT(populateDebugMenu()));
+    m_debugMenu->removeAction(m_inspectorAction);
+
+    m_debugMenu->addAction("Dump User Interface Map", this, SLOT(dumpUserInterfaceMap()));
+    m_debugMenu->addAction("Dump Preconnect Statistics", this, SLOT(dumpPreconnectStatistics()));
+    m_debugMenu->addAction("Dump Page Pool", this, SLOT(dumpPagePool()));
+    m_debugMenu->addAction("Dump RUI Processes", this, SLOT(dumpRUIProcesses()));
+    m_debugMenu->addAction("Dump Page Load Timings", this, SLOT(dumpPageLoadTimings()));
+    m_debugMenu->addAction("Dump Prefetch Status", this, SLOT(dumpPrefetchStatus()));
+    m_debugMenu->addAction("Dump Host Latency", this, SLOT(dumpHostLatency()));
+    m_debugMenu->addAction("Dump Memory Report", this, SLOT(dumpMemoryReport()));
+    m_debugMenu->addAction("Export Memory Report...", this, SLOT(exportMemoryReport()));
+    QMenu* pressureMenu = m_debugMenu->addMenu("Simulate Memory Pressure");
+    QActionGroup* pressureGroup = new QActionGroup(pressureMenu);
+    for (int level = -1; level <= MemoryPressureMonitor::Critical; level++) {
+        QAction* action = pressureMenu->addAction(MemoryPressureMonitor::levelName(level));
+        action->setCheckable(true);
+        action->setChecked(level == -1);
+        action->setData(level);
+        pressureGroup->addAction(action);
+    }
+    connect(pressureGroup, SIGNAL(triggered(QAction*)), this, SLOT(simulateMemoryPressure(QAction*)));
+    m_debugMenu->addAction("Export Page Load Timings...", this, SLOT(exportPageLoadTimings()));
+    m_debugMenu->addAction("Dump HTTP Cache Statistics", this, SLOT(dumpCacheStatistics()));
+    m_debugMenu->addAction("Clear HTTP Cache", this, SLOT(clearCache()));
+    QAction* recordHar = m_debugMenu->addAction("Record HAR", this, SLOT(toggleHarRecording(bool)));
+    recordHar->setCheckable(true);
+    m_debugMenu->addAction("Export HAR...", this, SLOT(exportHar()));
+    QAction* recordTrace = m_debugMenu->addAction("Record Trace", this, SLOT(toggleTracing(bool)));
+    recordTrace->setCheckable(true);
+    recordTrace->setChecked(TraceRecorder::isEnabled());
+    m_debugMenu->addAction("Export Trace...", this, SLOT(exportTrace()));
+    m_debugMenu->addSeparator();
+    m_debugMenu->addAction("Dump HTML", this, SLOT(dumpHtml()));
+    m_debugMenu->addAction("Benchmark JavaScript Bridge", this, SLOT(benchmarkBridge()));
+    m_debugMenu->addAction("Benchmark Navigation Renderer", this, SLOT(benchmarkRenderer()));
+    m_debugMenu->addAction("Benchmark Navigation Keys", this, SLOT(benchmarkNavigationKeys()));
     QString enableProxy = "Enable ";
     enableProxy += m_browserSettings->proxyType;
     enableProxy += " Proxy";
-    QAction* enableHttpProxy = debugMenu->addAction(enableProxy, this, SLOT(toggleHttpProxy(bool)));
+    QAction* enableHttpProxy = m_debugMenu->addAction(enableProxy, this, SLOT(toggleHttpProxy(bool)));
     enableHttpProxy->setCheckable(true);
     enableHttpProxy->setChecked(m_browserSettings->proxyEnabled);
-    debugMenu->addSeparator();
-    QAction* showInspectorAction = debugMenu->addAction("Web Inspector", this, SLOT(toggleWebInspector(bool)), QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_I));
-    showInspectorAction->setCheckable(true);
-    showInspectorAction->connect(m_inspector, SIGNAL(visibleChanged(bool)), SLOT(setChecked(bool)));
+    m_debugMenu->addSeparator();
+    m_debugMenu->addAction(m_inspectorAction);
 }
 
 void MainWindow::fullScreenOn()
@@ -235,7 +531,8 @@ void MainWindow::fullScreen(bool on)
     if (on) {
         menuBar()->hide();
         m_navigationBar->hide();
-        m_inspector->setVisible(false);
+        if (m_inspector)
+            m_inspector->setVisible(false);
         setWindowState( windowState() | Qt::WindowFullScreen );
         QApplication::setOverrideCursor(QCursor(Qt::BlankCursor));
 
@@ -248,7 +545,8 @@ void MainWindow::fullScreen(bool on)
         if (m_browserSettings->hasNavigationBar) {
             m_navigationBar->show();
         }
-        m_inspector->setVisible(m_browserSettings->hasWebInspector);
+        if (m_inspector || m_browserSettings->hasWebInspector)
+            inspector()->setVisible(m_browserSettings->hasWebInspector);
         QApplication::setOverrideCursor(QCursor(Qt::ArrowCursor));
     }
 }
@@ -271,11 +569,27 @@ void MainWindow::openFile()
 
 void MainWindow::home()
 {
+    TRACE_SCOPE("ui", "home");
+
     // TODO: if RUI list > 1, display list, otherwise display default.
 
     // Default RUI. What if there is no default RUI and nothing is discovered?
 
-    load("rui:home");
+    cancelPrerender();
+
+    if (m_processHost) {
+        showProcessView(false);
+        m_processHost->unload();
+    }
+
+    // The navigation page is resident (loaded by the constructor), so just show it.
+    if (m_page != m_homePage) {
+        showPage(m_homePage, QUrl());
+    }
+
+    setAddressUrl(QString(rui_home));
+    m_navigationBridge->setHome(true);
+    RUIPrefetcher::Instance()->setShowingRUI(this, false);
     return;
 
     QString url = m_browserSettings->defaultRUIUrl;
@@ -333,13 +647,232 @@ void MainWindow::load(const QString& url)
 
 void MainWindow::load(const QUrl& url)
 {
+    TRACE_SCOPE("ui", "load");
+
     if (!url.isValid())
         return;
 
+    if (url == QUrl(rui_home)) {
+        home();
+        return;
+    }
+
     setAddressUrl(url.toString());
+
+    // The RUI gets the bandwidth.
+    RUIPrefetcher::Instance()->setShowingRUI(this, true);
+
+    // Shown by the child process; the navigation page stays in the view underneath.
+    if (m_processHost) {
+        cancelPrerender();
+        m_processHost->load(url, m_discoveryProxy->isHostRUITransportServer(url.host()));
+        m_navigationBridge->setHome(false);
+        showProcessView(true);
+        return;
+    }
+
+    if (takePrerenderedPage(url))
+        return;
+
+    // Switch back to a live page for this RUI, if we still have one.
+    RUIWebPage* pooledPage = m_pagePool.take(url);
+    if (pooledPage) {
+        cancelPrerender();
+        showPage(pooledPage, url);
+        m_navigationBridge->setHome(false);
+        fprintf(stderr, "Resumed pooled page for %s\n", url.toString().toUtf8().data());
+        return;
+    }
+
+    cancelPrerender();
+
+    // RUIs never load into the navigation page. A RUI we are leaving is kept alive in the pool.
+    if (m_page == m_homePage || (!m_pageKey.isEmpty() && m_pagePool.isEnabled())) {
+        showPage(takeSparePage(), QUrl());
+    }
+
+    m_pageKey = url;
     m_page->mainFrame()->load(url);
 }
 
+// Here to put page in the view. key is the RUI URI page was opened with (empty for anything
+// else). The page being replaced goes to the page pool if it's a RUI, and is deleted otherwise,
+// unless it's the resident navigation page.
+void MainWindow::showPage(RUIWebPage* page, const QUrl& key)
+{
+    TRACE_SCOPE("ui", "showPage");
+
+    RUIWebPage* oldPage = m_page;
+    QUrl oldKey = m_pageKey;
+
+    setPage(page);
+    m_pageKey = key;
+
+    if (oldPage == m_homePage) {
+        // Stays loaded in the background.
+    } else if (!oldKey.isEmpty() && m_pagePool.isEnabled()) {
+        m_pagePool.put(oldKey, oldPage);
+    } else {
+        oldPage->deleteLater();
+    }
+}
+
+// Here when a RUI was selected on the navigation page.
+void MainWindow::onUISelected(const QString& uri)
+{
+    load(uri);
+}
+
+// Here when the highlighted RUI on the navigation page changes. If prerendering is enabled,
+// (re)start the dwell timer; the RUI is loaded off-screen once the selection has been stable.
+void MainWindow::onUIHighlighted(const QString& uri)
+{
+    if (!m_browserSettings->prerenderEnabled || m_processHost)
+        return;
+
+    QUrl url = urlFromUserInput(uri);
+    if (m_prerenderPage && url == m_prerenderUrl)
+        return;
+
+    cancelPrerender();
+    m_prerenderUrl = url;
+    m_prerenderTimer.start();
+}
+
+void MainWindow::scheduleSparePage()
+{
+    if (m_browserSettings->sparePageEnabled && !m_sparePage && !m_processHost)
+        QTimer::singleShot(SPARE_PAGE_DELAY_MS, this, SLOT(createSparePage()));
+}
+
+// Here at idle to build the page the next navigation will use, off the critical path: the
+// page, its settings, network access manager and SSL handlers, and its JavaScript context.
+void MainWindow::createSparePage()
+{
+    TRACE_SCOPE("ui", "createSparePage");
+
+    if (m_sparePage || !m_browserSettings->sparePageEnabled)
+        return;
+
+    m_sparePage = new RUIWebPage(this);
+    m_sparePage->setViewportSize(m_view->size());
+    m_sparePage->mainFrame()->evaluateJavaScript("void 0");
+}
+
+// Returns a page for a new navigation: the spare one if it's ready, otherwise a new one.
+RUIWebPage* MainWindow::takeSparePage()
+{
+    RUIWebPage* page = m_sparePage;
+    m_sparePage = 0;
+
+    if (!page) {
+        page = new RUIWebPage(this);
+    }
+
+    scheduleSparePage();
+    return page;
+}
+
+// Startup-to-first-RUI benchmark (--benchmark-launch). Gives the navigation page time to come
+// up, then loads uri and reports how long it took; the application exits afterwards.
+void MainWindow::benchmarkLaunch(const QString& uri)
+{
+    m_benchmarkUri = uri;
+    QTimer::singleShot(BENCHMARK_LAUNCH_DELAY_MS, this, SLOT(startBenchmarkLaunch()));
+}
+
+void MainWindow::startBenchmarkLaunch()
+{
+    bool spareReady = (m_sparePage != 0);
+
+    m_launchClock.start();
+    load(m_benchmarkUri);
+
+    fprintf(stderr, "Benchmark: launching %s (spare page %s)\n",
+            m_benchmarkUri.toUtf8().data(), spareReady ? "ready" : "not available");
+    connect(m_page, SIGNAL(loadFinished(bool)), this, SLOT(onBenchmarkLaunchFinished(bool)));
+}
+
+void MainWindow::onBenchmarkLaunchFinished(bool ok)
+{
+    fprintf(stderr, "Benchmark: first RUI %s in %lld ms (%lld ms since startup)\n",
+            ok ? "loaded" : "failed", m_launchClock.elapsed(), StartupTrace::elapsed());
+    QApplication::quit();
+}
+
+// Only one prerender at a time; it is dropped as soon as the selection moves.
+void MainWindow::startPrerender()
+{
+    TRACE_SCOPE("ui", "startPrerender");
+
+    if (m_prerenderPage || !m_prerenderUrl.isValid())
+        return;
+
+    fprintf(stderr, "Prerendering %s\n", m_prerenderUrl.toString().toUtf8().data());
+
+    m_prerenderPage = takeSparePage();
+    m_prerenderPage->setVisibilityState(QWebPage::VisibilityStatePrerender);
+    m_prerenderPage->setViewportSize(m_view->size());
+    connect(m_prerenderPage, SIGNAL(loadProgress(int)), this, SLOT(checkPrerenderBudget()));
+    connect(m_prerenderPage, SIGNAL(loadFinished(bool)), this, SLOT(onPrerenderFinished(bool)));
+    m_prerenderPage->mainFrame()->load(m_prerenderUrl);
+}
+
+void MainWindow::cancelPrerender()
+{
+    m_prerenderTimer.stop();
+
+    if (m_prerenderPage) {
+        disconnect(m_prerenderPage, 0, this, 0);
+        m_prerenderPage->triggerAction(QWebPage::Stop);
+        m_prerenderPage->deleteLater();
+        m_prerenderPage = 0;
+    }
+
+    m_prerenderUrl = QUrl();
+}
+
+// Memory guard: a RUI that pulls in more than the configured budget is not worth keeping hidden.
+void MainWindow::checkPrerenderBudget()
+{
+    if (m_prerenderPage && m_prerenderPage->totalBytes() > qint64(m_browserSettings->prerenderMaxKB) * 1024) {
+        fprintf(stderr, "Prerender of %s exceeds %d KB, cancelled\n",
+                m_prerenderUrl.toString().toUtf8().data(), m_browserSettings->prerenderMaxKB);
+        cancelPrerender();
+    }
+}
+
+void MainWindow::onPrerenderFinished(bool ok)
+{
+    if (!ok) {
+        fprintf(stderr, "Prerender of %s failed\n", m_prerenderUrl.toString().toUtf8().data());
+        cancelPrerender();
+    }
+}
+
+// Here to show the prerendered page instead of loading url again. Returns false if we don't
+// have a prerender of url.
+bool MainWindow::takePrerenderedPage(const QUrl& url)
+{
+    if (!m_prerenderPage || url != m_prerenderUrl)
+        return false;
+
+    RUIWebPage* page = m_prerenderPage;
+    m_prerenderPage = 0;
+    m_prerenderUrl = QUrl();
+    disconnect(page, 0, this, 0);
+
+    page->setVisibilityState(QWebPage::VisibilityStateVisible);
+    showPage(page, url);
+
+    // The page was loaded off-screen, so we won't see its load signals.
+    m_navigationBridge->setHome(false);
+    m_discoveryProxy->notePageLoad(url);
+
+    fprintf(stderr, "Showing prerendered %s\n", url.toString().toUtf8().data());
+    return true;
+}
+
 QString MainWindow::addressUrl() const
 {
     if (m_browserSettings->hasUrlEdit) {
@@ -371,11 +904,189 @@ void MainWindow::dumpHtml()
     fprintf(stderr,"\nHTML:\n%s\n", html.toUtf8().data());
 }
 
+void MainWindow::benchmarkBridge()
+{
+    BridgeBenchmark benchmark;
+    benchmark.run();
+}
+
+void MainWindow::benchmarkRenderer()
+{
+    BridgeBenchmark benchmark;
+    benchmark.runRenderer();
+}
+
+// Here to time key presses on the navigation screen, web or native, from the key event until
+// the screen is repainted. Reported with the resident size, to compare the two.
+void MainWindow::benchmarkNavigationKeys()
+{
+    if (m_page != m_homePage) {
+        fprintf(stderr, "Benchmark: the navigation screen isn't showing\n");
+        return;
+    }
+
+    QWidget* target = m_navigationView ? (QWidget*)m_navigationView : (QWidget*)m_view;
+    QVector<qint64> samples;
+    QElapsedTimer clock;
+
+    for (int i = 0; i < NAVIGATION_BENCHMARK_KEYS; i++) {
+        // Ten down, ten up, so lists longer than a screen scroll as well.
+        int key = ((i / 10) % 2) ? Qt::Key_Up : Qt::Key_Down;
+        QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier);
+        QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier);
+
+        clock.start();
+        QApplication::sendEvent(target, &press);
+        target->repaint();
+        samples.append(clock.nsecsElapsed());
+
+        QApplication::sendEvent(target, &release);
+    }
+
+    qSort(samples);
+    qint64 total = 0;
+    foreach (qint64 sample, samples)
+        total += sample;
+
+    fprintf(stderr, "Benchmark: %s navigation, %d keys, key to paint: mean %.2f ms, p95 %.2f ms, max %.2f ms; resident %lld KB\n",
+            m_navigationView ? "native" : "web", samples.count(),
+            total / 1e6 / samples.count(),
+            samples[samples.count() * 95 / 100] / 1e6,
+            samples.last() / 1e6,
+            MemoryGovernor::residentMemory() / 1024);
+}
+
 void MainWindow::dumpUserInterfaceMap()
 {
     m_discoveryProxy->dumpUserInterfaceMap();
 }
 
+void MainWindow::dumpPagePool()
+{
+    m_pagePool.dump();
+}
+
+void MainWindow::dumpRUIProcesses()
+{
+    if (m_processHost)
+        m_processHost->dump();
+    else
+        fprintf(stderr, "\nRUI child processes are not enabled (performance/processPerRUI)\n");
+}
+
+void MainWindow::dumpPreconnectStatistics()
+{
+    m_discoveryProxy->dumpPreconnectStatistics();
+}
+
+void MainWindow::dumpCacheStatistics()
+{
+    RUINetworkAccessManager::Instance()->dumpCacheStatistics();
+}
+
+void MainWindow::clearCache()
+{
+    RUINetworkAccessManager::Instance()->clearCache();
+}
+
+void MainWindow::dumpPageLoadTimings()
+{
+    PageLoadTimings::Instance()->dump();
+}
+
+void MainWindow::dumpPrefetchStatus()
+{
+    RUIPrefetcher::Instance()->dump();
+}
+
+void MainWindow::dumpHostLatency()
+{
+    HostLatency::Instance()->dump();
+}
+
+void MainWindow::dumpMemoryReport()
+{
+    MemoryGovernor::Instance()->dump();
+}
+
+void MainWindow::exportMemoryReport()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Memory Report", "memory.json", "JSON Files (*.json)");
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "Unable to write %s\n", fileName.toUtf8().data());
+        return;
+    }
+
+    file.write(MemoryGovernor::Instance()->toJson());
+}
+
+void MainWindow::simulateMemoryPressure(QAction* action)
+{
+    MemoryPressureMonitor::Instance()->setSyntheticLevel(action->data().toInt());
+}
+
+// Here to shed the memory the memory pressure monitor can't reach: live pages we could do without.
+void MainWindow::onMemoryPressureTier(int tier)
+{
+    if (tier != MemoryPressureMonitor::Severe)
+        return;
+
+    m_pagePool.clear();
+    cancelPrerender();
+    if (m_sparePage) {
+        m_sparePage->deleteLater();
+        m_sparePage = 0;
+    }
+}
+
+void MainWindow::exportPageLoadTimings()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Page Load Timings", "pageloadtimings.json", "JSON Files (*.json)");
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "Unable to write %s\n", fileName.toUtf8().data());
+        return;
+    }
+
+    file.write(PageLoadTimings::Instance()->toJson());
+}
+
+void MainWindow::toggleHarRecording(bool on)
+{
+    HarRecorder::Instance()->setRecording(on);
+}
+
+void MainWindow::exportHar()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export HAR", "qtruibrowser.har", "HAR Files (*.har)");
+    if (fileName.isEmpty())
+        return;
+
+    HarRecorder::Instance()->save(fileName);
+}
+
+void MainWindow::toggleTracing(bool on)
+{
+    TraceRecorder::Instance()->setEnabled(on);
+}
+
+// The trace opens in about:tracing or ui.perfetto.dev.
+void MainWindow::exportTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Trace", "qtruibrowser-trace.json", "JSON Files (*.json)");
+    if (fileName.isEmpty())
+        return;
+
+    TraceRecorder::Instance()->save(fileName);
+}
+
 void MainWindow::toggleNavigationBar(bool b)
 {
     m_browserSettings->hasNavigationBar = b;
@@ -423,7 +1134,7 @@ void MainWindow::toggleHttpProxy(bool b)
 void MainWindow::toggleWebInspector(bool b) {
     m_browserSettings->hasWebInspector = b;
     m_browserSettings->save();
-    m_inspector->setVisible(b);
+    inspector()->setVisible(b);
 }
 
 
@@ -445,11 +1156,14 @@ void MainWindow::onIconChanged()
 
 void MainWindow::onLoadStarted()
 {
+    TRACE_INSTANT("ui", "load started");
+
     if (m_browserSettings->hasUrlEdit) {
         m_urlEdit->setPageIcon(QIcon());
     }
 
-    m_discoveryProxy->m_home = false;
+    m_navigationBridge->setHome(false);
+    m_discoveryProxy->notePageLoad(m_page->mainFrame()->requestedUrl());
 }
 
 void MainWindow::onTitleChanged(const QString& title)
@@ -462,7 +1176,14 @@ void MainWindow::onTitleChanged(const QString& title)
 
 bool MainWindow::eventFilter(QObject* object, QEvent* event)
 {
+    // Reported once the paint is done.
+    if (event->type() == QEvent::Paint && !m_homePainted && m_homeLaidOut && m_page == m_homePage) {
+        m_homePainted = true;
+        QMetaObject::invokeMethod(this, "onHomePainted", Qt::QueuedConnection);
+    }
+
     if (event->type() == QEvent::KeyPress) {
+        TRACE_INSTANT("ui", "key press");
 
         QKeyEvent* keyEvent = (QKeyEvent*)event;
 
@@ -496,29 +1217,24 @@ bool MainWindow::eventFilter(QObject* object, QEvent* event)
 
 void MainWindow::attachProxyObject()
 {
-    m_page->mainFrame()->addToJavaScriptWindowObject( QString("discoveryProxy"), m_discoveryProxy );
-    m_discoveryProxy->m_home = true;
+    m_homePage->mainFrame()->addToJavaScriptWindowObject( QString("discoveryProxy"), m_navigationBridge );
 }
 
-// Here when the global window object of the JavaScript environment is cleared, e.g., before starting a new load
-// If this is the rui:home page, add our discovery proxy to the window.
+// Here when the global window object of the navigation page's JavaScript environment is cleared,
+// i.e., before it (re)loads. Add our discovery proxy to the window.
 void MainWindow::onJavaScriptWindowObjectCleared()
 {
-    QString url = m_view->url().toString();
-
-    if (url.compare(rui_home) == 0) {
-        attachProxyObject();
-    } else {
-        m_discoveryProxy->m_home = false;
-    }
+    attachProxyObject();
 }
 
 // Here when a page load is finished.
 // If this is the rui:home page, signal that the UI list is available.
 void MainWindow::onPageLoaded(bool ok)
 {
+    TRACE_INSTANT("ui", "load finished");
+
     if (ok) {
         QString url = m_view->url().toString();
-        m_discoveryProxy->m_home = (url.compare(rui_home) == 0);
+        m_navigationBridge->setHome(url.compare(rui_home) == 0);
     }
 }
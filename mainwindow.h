@@ -29,15 +29,24 @@
 #include <QMainWindow>
 #include <QStringListModel>
 #include <QToolBar>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QUrl>
 #include <QWebView>
 #include "discoveryproxy.h"
 #include "qwebinspector.h"
 #include "webinspector.h"
+#include "ruipagepool.h"
 
 class LocationEdit;
+class QSplitter;
 class TVRemoteBridge;
 class BrowserSettings;
 class RUIWebPage;
+class RUIListModel;
+class NavigationView;
+class NavigationBridge;
+class RUIProcessHost;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -50,6 +59,8 @@ public:
     void load(const QUrl& url);
     void home();
     void checkHttpProxyEnabled();
+    void benchmarkLaunch(const QString& uri);
+    void benchmarkStartup();
 
 protected slots:
     void setAddressUrl(const QString& url);
@@ -61,14 +72,56 @@ protected slots:
     void toggleHttpProxy(bool on);
     void toggleWebInspector(bool on);
     void dumpUserInterfaceMap();
+    void dumpPreconnectStatistics();
+    void dumpCacheStatistics();
+    void clearCache();
+    void dumpPageLoadTimings();
+    void dumpPrefetchStatus();
+    void dumpHostLatency();
+    void dumpMemoryReport();
+    void exportMemoryReport();
+    void simulateMemoryPressure(QAction* action);
+    void onMemoryPressureTier(int tier);
+    void exportPageLoadTimings();
+    void toggleHarRecording(bool on);
+    void exportHar();
+    void toggleTracing(bool on);
+    void exportTrace();
+    void dumpPagePool();
+    void dumpRUIProcesses();
     void dumpHtml();
+    void benchmarkBridge();
+    void benchmarkRenderer();
+    void benchmarkNavigationKeys();
     void fullScreenOn();
+    void populateDebugMenu();
+    void startDiscovery();
 
     void onIconChanged();
     void onLoadStarted();
     void onTitleChanged(const QString&);
     void onPageLoaded(bool);
     void onJavaScriptWindowObjectCleared();
+    void onUISelected(const QString& uri);
+    void onUIHighlighted(const QString& uri);
+    void onHomeLayoutCompleted();
+    void onHomePainted();
+
+    // Spare page
+    void createSparePage();
+
+    // Process-per-RUI
+    void onProcessContainerChanged(QWidget* container);
+    void onProcessHomeRequested();
+
+    // Benchmark
+    void startBenchmarkLaunch();
+    void onBenchmarkLaunchFinished(bool ok);
+
+    // Prerender
+    void startPrerender();
+    void checkPrerenderBudget();
+    void onPrerenderFinished(bool ok);
 
 protected:
     QString addressUrl() const;
@@ -76,20 +129,53 @@ protected:
 
 private:
     void buildUI();
+    void setPage(RUIWebPage* page);
+    void showPage(RUIWebPage* page, const QUrl& key);
+    void connectPage(RUIWebPage* page);
+    void disconnectPage(RUIWebPage* page);
+    void cancelPrerender();
+    void scheduleSparePage();
+    RUIWebPage* takeSparePage();
+    bool takePrerenderedPage(const QUrl& url);
     void createMenuBar();
+    WebInspector* inspector();
     void attachProxyObject();
     void enableHttpProxy();
     void fullScreen(bool on);
+    void showProcessView(bool on);
 
     QWebView* m_view;
     RUIWebPage* m_page;
+    RUIWebPage* m_homePage;  // not loaded when the native navigation screen is used instead
+    RUIListModel* m_navigationModel;
+    NavigationView* m_navigationView;
+    QUrl m_pageKey;  // RUI URI the current page was opened with, empty for the navigation page
+    RUIPagePool m_pagePool;
+    RUIWebPage* m_prerenderPage;
+    QUrl m_prerenderUrl;
+    QTimer m_prerenderTimer;
+    RUIWebPage* m_sparePage;
+    RUIProcessHost* m_processHost;  // RUIs are shown by a child process (performance/processPerRUI)
+    bool m_processShowing;
+    QElapsedTimer m_launchClock;
+    QString m_benchmarkUri;
     QToolBar* m_navigationBar;
+    QMenu* m_viewMenu;
+    QMenu* m_debugMenu;
+    QAction* m_inspectorAction;
     QStringListModel m_urlModel;
     QStringList m_urlList;
     LocationEdit* m_urlEdit;
     DiscoveryProxy* m_discoveryProxy;
+    NavigationBridge* m_navigationBridge;  // this window's navigation state, over the shared proxy
     BrowserSettings* m_browserSettings;
-    WebInspector* m_inspector;
+    QSplitter* m_splitter;
+    WebInspector* m_inspector;  // created on first use
+
+    // Startup
+    bool m_homeLaidOut;
+    bool m_homePainted;
+    bool m_benchmarkStartup;
 };
 
 #endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "memorygovernor.h"
+#include "browsersettings.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QWebSettings>
+
+static const qint64 MB = 1024 * 1024;
+
+// Used when the amount of physical memory can't be determined.
+static const qint64 DEFAULT_PHYSICAL_MEMORY = 512 * MB;
+
+// Cache capacity limits, and the cache capacity that buys one page in the page cache.
+static const qint64 MIN_CACHE_CAPACITY = 2 * MB;
+static const qint64 MAX_CACHE_CAPACITY = 256 * MB;
+static const qint64 CACHE_PER_PAGE = 4 * MB;
+static const int MAX_PAGES_IN_CACHE = 8;
+
+// Here to avoid flushing the object cache over small changes; smaller changes are ignored.
+static const int RETUNE_THRESHOLD_PERCENT = 10;
+
+MemoryGovernor* MemoryGovernor::m_pInstance = NULL;
+
+MemoryGovernor::MemoryGovernor()
+    : m_budget(0)
+    , m_cacheCapacity(0)
+    , m_pagesInCache(0)
+    , m_retunes(0)
+    , m_underPressure(false)
+{
+    connect(&m_retuneTimer, SIGNAL(timeout()), this, SLOT(retune()));
+}
+
+MemoryGovernor* MemoryGovernor::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new MemoryGovernor;
+    }
+
+    return m_pInstance;
+}
+
+qint64 MemoryGovernor::physicalMemory()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0)
+        return qint64(pages) * pageSize;
+#endif
+    return DEFAULT_PHYSICAL_MEMORY;
+}
+
+// Current resident set size from /proc where there is one, otherwise the peak from getrusage().
+qint64 MemoryGovernor::residentMemory()
+{
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.count() > 1)
+            return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(Q_OS_MAC)
+        return usage.ru_maxrss;
+#else
+        return qint64(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    return -1;
+}
+
+// Here at startup, before any page is created.
+void MemoryGovernor::start()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+
+    m_budget = settings->memoryBudgetMB > 0 ? settings->memoryBudgetMB * MB : physicalMemory() / 4;
+    retune();
+
+    if (settings->memoryRetuneSeconds > 0)
+        m_retuneTimer.start(settings->memoryRetuneSeconds * 1000);
+}
+
+// The caches are assumed to be full, so the rest of the process is what's resident beyond them.
+void MemoryGovernor::retune()
+{
+    if (m_underPressure)
+        return;
+
+    qint64 resident = residentMemory();
+    qint64 rest = qMax(qint64(0), resident - m_cacheCapacity);
+
+    qint64 capacity = qMin(m_budget - rest, m_budget / 8);
+    capacity = qBound(MIN_CACHE_CAPACITY, capacity, MAX_CACHE_CAPACITY);
+
+    qint64 change = qAbs(capacity - m_cacheCapacity);
+    if (m_cacheCapacity && change * 100 < m_cacheCapacity * RETUNE_THRESHOLD_PERCENT)
+        return;
+
+    applyCacheCapacity(capacity);
+}
+
+void MemoryGovernor::setUnderPressure(bool underPressure)
+{
+    if (underPressure == m_underPressure)
+        return;
+
+    m_underPressure = underPressure;
+    if (underPressure) {
+        applyCacheCapacity(MIN_CACHE_CAPACITY);
+    } else {
+        retune();
+    }
+}
+
+// Same proportions as the fixed configuration this replaces: an eighth of the object cache for
+// dead resources, and a page in the page cache for every 4 MB.
+void MemoryGovernor::applyCacheCapacity(qint64 capacity)
+{
+    m_cacheCapacity = capacity;
+    QWebSettings::setObjectCacheCapacities(capacity / 8, capacity / 8, capacity);
+
+    int pages = qBound(1, int(capacity / CACHE_PER_PAGE), MAX_PAGES_IN_CACHE);
+    if (pages != m_pagesInCache) {
+        m_pagesInCache = pages;
+        QWebSettings::setMaximumPagesInCache(pages);
+    }
+
+    m_retunes++;
+    fprintf(stderr, "Memory: budget %lld MB, WebKit object cache %lld MB, %d pages in cache\n",
+            m_budget / MB, capacity / MB, pages);
+}
+
+// WebKit doesn't expose how much of its caches is in use, so the capacities are reported, and
+// named as such.
+QVariantMap MemoryGovernor::report()
+{
+    QVariantMap map;
+    map["physicalMemory"] = physicalMemory();
+    map["budget"] = m_budget;
+    map["residentMemory"] = residentMemory();
+    map["objectCacheCapacity"] = m_cacheCapacity;
+    map["pageCacheCapacity"] = m_pagesInCache;
+    map["retunes"] = m_retunes;
+    map["underPressure"] = m_underPressure;
+    return map;
+}
+
+QByteArray MemoryGovernor::toJson()
+{
+    return QJsonDocument(QJsonObject::fromVariantMap(report())).toJson();
+}
+
+void MemoryGovernor::dump()
+{
+    QVariantMap map = report();
+
+    fprintf(stderr, "Memory:\n");
+    fprintf(stderr, "- physical memory: %lld MB, budget: %lld MB\n",
+            map["physicalMemory"].toLongLong() / MB, map["budget"].toLongLong() / MB);
+    fprintf(stderr, "- resident: %lld KB\n", map["residentMemory"].toLongLong() / 1024);
+    fprintf(stderr, "- WebKit object cache capacity: %lld KB, page cache capacity: %d pages (retuned %d times)\n",
+            map["objectCacheCapacity"].toLongLong() / 1024, map["pageCacheCapacity"].toInt(), map["retunes"].toInt());
+}
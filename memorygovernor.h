@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef MEMORYGOVERNOR_H
+#define MEMORYGOVERNOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+
+// The MemoryGovernor sizes the WebKit caches (object cache and page cache) for the machine we
+// run on. The process gets a memory budget, memory/budgetMB or a quarter of physical memory,
+// and the caches get what the rest of the process leaves of it, up to an eighth of the budget.
+// This is retuned periodically as the process grows and shrinks.
+class MemoryGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MemoryGovernor* Instance();
+
+    void start();
+
+    qint64 budget() const { return m_budget; }
+    qint64 cacheCapacity() const { return m_cacheCapacity; }
+    int pagesInCache() const { return m_pagesInCache; }
+
+    static qint64 physicalMemory();
+    static qint64 residentMemory();
+
+    QVariantMap report();
+    QByteArray toJson();
+    void dump();
+
+    // While under memory pressure the caches are kept at their minimum.
+    void setUnderPressure(bool underPressure);
+
+public slots:
+    void retune();
+
+private:
+    MemoryGovernor();
+    static MemoryGovernor* m_pInstance;
+
+    void applyCacheCapacity(qint64 capacity);
+
+    QTimer m_retuneTimer;
+    qint64 m_budget;
+    qint64 m_cacheCapacity;
+    int m_pagesInCache;
+    int m_retunes;
+    bool m_underPressure;
+};
+
+#endif // MEMORYGOVERNOR_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "memorypressuremonitor.h"
+#include "discoveryproxy.h"
+#include "iconatlas.h"
+#include "iconcache.h"
+#include "memorygovernor.h"
+
+#include <stdio.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <QFile>
+#include <QPixmapCache>
+#include <QRegExp>
+#include <QWebSettings>
+
+static const int POLL_INTERVAL_MS = 1000;
+
+// While pressure persists, the tiers are applied again this often.
+static const int REAPPLY_INTERVAL_MS = 30000;
+
+// PSI: share of time (avg10, %) some or all tasks were stalled on memory.
+static const double PSI_SOME_MODERATE = 10;
+static const double PSI_SOME_HIGH = 20;
+static const double PSI_SOME_SEVERE = 40;
+static const double PSI_FULL_CRITICAL = 10;
+
+// /proc/meminfo: MemAvailable as a share (%) of MemTotal.
+static const int AVAILABLE_MODERATE = 20;
+static const int AVAILABLE_HIGH = 12;
+static const int AVAILABLE_SEVERE = 7;
+static const int AVAILABLE_CRITICAL = 4;
+
+MemoryPressureMonitor* MemoryPressureMonitor::m_pInstance = NULL;
+
+MemoryPressureMonitor::MemoryPressureMonitor()
+    : m_syntheticLevel(-1)
+    , m_level(None)
+    , m_appliedLevel(None)
+{
+    connect(&m_pollTimer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+MemoryPressureMonitor* MemoryPressureMonitor::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new MemoryPressureMonitor;
+    }
+
+    return m_pInstance;
+}
+
+const char* MemoryPressureMonitor::levelName(int level)
+{
+    static const char* names[] = { "none", "moderate", "high", "severe", "critical" };
+    return (level >= None && level <= Critical) ? names[level] : "real";
+}
+
+void MemoryPressureMonitor::start()
+{
+    m_pollTimer.start(POLL_INTERVAL_MS);
+    poll();
+}
+
+void MemoryPressureMonitor::setSyntheticLevel(int level)
+{
+    m_syntheticLevel = qBound(-1, level, int(Critical));
+    fprintf(stderr, "Memory pressure: synthetic level %s\n", levelName(m_syntheticLevel));
+    poll();
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::readPressure(QString* detail)
+{
+    if (m_syntheticLevel >= 0) {
+        *detail = "synthetic";
+        return Level(m_syntheticLevel);
+    }
+
+    if (QFile::exists("/proc/pressure/memory"))
+        return readPSI(detail);
+
+    return readMeminfo(detail);
+}
+
+// some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+// full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+MemoryPressureMonitor::Level MemoryPressureMonitor::readPSI(QString* detail)
+{
+    QFile file("/proc/pressure/memory");
+    if (!file.open(QIODevice::ReadOnly))
+        return None;
+
+    QString text = QString::fromLatin1(file.readAll());
+    QRegExp some("some avg10=([0-9.]+)");
+    QRegExp full("full avg10=([0-9.]+)");
+    double someAvg10 = some.indexIn(text) != -1 ? some.cap(1).toDouble() : 0;
+    double fullAvg10 = full.indexIn(text) != -1 ? full.cap(1).toDouble() : 0;
+
+    *detail = QString("PSI some avg10=%1 full avg10=%2").arg(someAvg10).arg(fullAvg10);
+
+    if (fullAvg10 >= PSI_FULL_CRITICAL)
+        return Critical;
+    if (someAvg10 >= PSI_SOME_SEVERE)
+        return Severe;
+    if (someAvg10 >= PSI_SOME_HIGH)
+        return High;
+    if (someAvg10 >= PSI_SOME_MODERATE)
+        return Moderate;
+    return None;
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::readMeminfo(QString* detail)
+{
+    QFile file("/proc/meminfo");
+    if (!file.open(QIODevice::ReadOnly))
+        return None;
+
+    QString text = QString::fromLatin1(file.readAll());
+    QRegExp total("MemTotal:\\s+(\\d+)");
+    QRegExp available("MemAvailable:\\s+(\\d+)");
+    if (total.indexIn(text) == -1 || available.indexIn(text) == -1)
+        return None;
+
+    qint64 totalKB = total.cap(1).toLongLong();
+    qint64 availableKB = available.cap(1).toLongLong();
+    if (totalKB <= 0)
+        return None;
+
+    int percent = int(availableKB * 100 / totalKB);
+    *detail = QString("MemAvailable %1 KB (%2%)").arg(availableKB).arg(percent);
+
+    if (percent < AVAILABLE_CRITICAL)
+        return Critical;
+    if (percent < AVAILABLE_SEVERE)
+        return Severe;
+    if (percent < AVAILABLE_HIGH)
+        return High;
+    if (percent < AVAILABLE_MODERATE)
+        return Moderate;
+    return None;
+}
+
+void MemoryPressureMonitor::poll()
+{
+    QString detail;
+    Level level = readPressure(&detail);
+
+    if (level != m_level) {
+        fprintf(stderr, "Memory pressure: %s -> %s (%s)\n", levelName(m_level), levelName(level), detail.toUtf8().data());
+        m_level = level;
+    }
+
+    if (level == None) {
+        if (m_appliedLevel != None) {
+            MemoryGovernor::Instance()->setUnderPressure(false);
+            m_appliedLevel = None;
+        }
+        return;
+    }
+
+    // Sustained pressure: start over, the caches have been filling up again.
+    if (m_appliedClock.isValid() && m_appliedClock.elapsed() > REAPPLY_INTERVAL_MS)
+        m_appliedLevel = None;
+
+    if (level <= m_appliedLevel)
+        return;
+
+    for (int tier = m_appliedLevel + 1; tier <= level; tier++) {
+        applyTier(tier);
+    }
+    m_appliedLevel = level;
+    m_appliedClock.start();
+}
+
+void MemoryPressureMonitor::applyTier(int tier)
+{
+    switch (tier) {
+    case Moderate:
+        fprintf(stderr, "Memory pressure: tier 1, clearing WebKit object and page caches\n");
+        MemoryGovernor::Instance()->setUnderPressure(true);
+        QWebSettings::clearMemoryCaches();
+        break;
+    case High:
+        fprintf(stderr, "Memory pressure: tier 2, dropping decoded images\n");
+        IconCache::Instance()->clearMemoryCache();
+        QPixmapCache::clear();
+        break;
+    case Severe:
+        fprintf(stderr, "Memory pressure: tier 3, trimming UI map data and pooled pages\n");
+        DiscoveryProxy::Instance()->trimMemory();
+        IconAtlas::Instance()->trimMemory();
+        break;
+    case Critical:
+        // There is no public call for a JavaScript garbage collection; clearing the memory caches
+        // has WebKit run one, and drops what the earlier tiers' trimming has released since.
+        fprintf(stderr, "Memory pressure: tier 4, collecting JavaScript garbage\n");
+        QWebSettings::clearMemoryCaches();
+#ifdef __GLIBC__
+        malloc_trim(0);
+#endif
+        break;
+    default:
+        return;
+    }
+
+    emit tierApplied(tier);
+}
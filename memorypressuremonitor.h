@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef MEMORYPRESSUREMONITOR_H
+#define MEMORYPRESSUREMONITOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+// The MemoryPressureMonitor watches for memory pressure and sheds memory in tiers before the
+// system runs out and the browser is killed. Pressure is read from /proc/pressure/memory (PSI)
+// or, on kernels without PSI, from MemAvailable in /proc/meminfo. A synthetic level can be set
+// instead (--memory-pressure, or the Debug menu) to test the response.
+//
+// Each level applies its tier and all of the tiers below it:
+//   1. Moderate: clear the WebKit object and page caches, and hold them at their minimum.
+//   2. High:     drop decoded images (icons, pixmaps).
+//   3. Severe:   trim the UserInterfaceMap's rebuildable data and the pooled RUI pages.
+//   4. Critical: run JavaScript garbage collection and return free heap to the system.
+class MemoryPressureMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level { None, Moderate, High, Severe, Critical };
+
+    static MemoryPressureMonitor* Instance();
+
+    void start();
+
+    // -1 returns to the real pressure source.
+    void setSyntheticLevel(int level);
+
+    Level level() const { return m_level; }
+    static const char* levelName(int level);
+
+signals:
+    // Emitted for each tier as it is applied, for memory the monitor doesn't own.
+    void tierApplied(int tier);
+
+private slots:
+    void poll();
+
+private:
+    MemoryPressureMonitor();
+    static MemoryPressureMonitor* m_pInstance;
+
+    Level readPressure(QString* detail);
+    static Level readPSI(QString* detail);
+    static Level readMeminfo(QString* detail);
+    void applyTier(int tier);
+
+    QTimer m_pollTimer;
+    int m_syntheticLevel;
+    Level m_level;
+    int m_appliedLevel;
+    QElapsedTimer m_appliedClock;
+};
+
+#endif // MEMORYPRESSUREMONITOR_H
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "navigationbridge.h"
+#include "discoveryproxy.h"
+#include "tracerecorder.h"
+
+#include <stdio.h>
+
+NavigationBridge::NavigationBridge(DiscoveryProxy* discoveryProxy, QObject *parent)
+    : QObject(parent)
+    , m_discoveryProxy(discoveryProxy)
+    , m_home(false)
+    , m_listChanged(false)
+    , m_scrollIndex(0)
+    , m_screenIndex(0)
+{
+    connect(m_discoveryProxy, SIGNAL(ruiListNotification()), this, SLOT(onListChanged()));
+}
+
+void NavigationBridge::setHome(bool home)
+{
+    m_home = home;
+
+    if (m_home && m_listChanged) {
+        m_listChanged = false;
+        emit ruiListNotification();
+    }
+}
+
+// Here when the catalogue changed. A hidden navigation page catches up when it's shown.
+void NavigationBridge::onListChanged()
+{
+    if (m_home) {
+        emit ruiListNotification();
+    } else {
+        m_listChanged = true;
+    }
+}
+
+QVariantList NavigationBridge::ruiList()
+{
+    return m_discoveryProxy->ruiList();
+}
+
+QString NavigationBridge::ruiListJson()
+{
+    return m_discoveryProxy->ruiListJson();
+}
+
+QString NavigationBridge::ruiListDelta(int sinceRevision)
+{
+    return m_discoveryProxy->ruiListDelta(sinceRevision);
+}
+
+QString NavigationBridge::iconAtlasURL()
+{
+    return m_discoveryProxy->iconAtlasURL();
+}
+
+// JavaScript output to application console.
+void NavigationBridge::console(const QString& str)
+{
+    fprintf( stderr,"%s\n", str.toUtf8().data());
+}
+
+int NavigationBridge::scrollIndex()
+{
+    return m_scrollIndex;
+}
+
+int NavigationBridge::screenIndex()
+{
+    return m_screenIndex;
+}
+
+void NavigationBridge::setScrollIndex(int index)
+{
+    m_scrollIndex = index;
+}
+
+void NavigationBridge::setScreenIndex(int index)
+{
+    m_screenIndex = index;
+}
+
+// Here from the navigation page when the selection moves. This is the URI selectUI() will load,
+// so have it preconnected.
+void NavigationBridge::highlightUI(const QString& uri)
+{
+    TRACE_SCOPE("bridge", "highlightUI");
+
+    emit uiHighlighted(uri);
+    m_discoveryProxy->preconnect(uri);
+}
+
+// Here from the navigation page when a RUI was chosen. The window decides how to show it.
+void NavigationBridge::selectUI(const QString& uri)
+{
+    TRACE_SCOPE("bridge", "selectUI");
+
+    emit uiSelected(uri);
+}
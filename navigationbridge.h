@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef NAVIGATIONBRIDGE_H
+#define NAVIGATIONBRIDGE_H
+
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+
+class DiscoveryProxy;
+
+// A window's view of the shared DiscoveryProxy: the object its navigation page (or native
+// navigation screen) talks to, exposed to JavaScript as discoveryProxy. It holds the window's
+// own navigation state, so several windows (--screens) share one discovery and catalogue but
+// keep their own position, and selections go to the window they were made in.
+class NavigationBridge : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NavigationBridge(DiscoveryProxy* discoveryProxy, QObject *parent = 0);
+
+    // True while the navigation page is showing. List changes are held back while it isn't,
+    // and delivered as one notification when it shows again.
+    bool isHome() const { return m_home; }
+    void setHome(bool home);
+
+signals:
+    void ruiListNotification();
+    void uiHighlighted(QString uri);
+    void uiSelected(QString uri);
+
+public slots:
+    // Public JavaScript API (bridge)
+    QVariantList ruiList();
+    QString ruiListJson();
+    QString ruiListDelta(int sinceRevision);
+    QString iconAtlasURL();
+    void console(const QString&);
+    int scrollIndex();
+    int screenIndex();
+    void setScrollIndex(int index);
+    void setScreenIndex(int index);
+    void highlightUI(const QString& uri);
+    void selectUI(const QString& uri);
+
+private slots:
+    void onListChanged();
+
+private:
+    DiscoveryProxy* m_discoveryProxy;
+    bool m_home;
+    bool m_listChanged;
+
+    // Persist the position on the navigation page, so when you return from a rui page, the last
+    // selected row and scroll position are restored.
+    int m_scrollIndex;
+    int m_screenIndex;
+};
+
+#endif // NAVIGATIONBRIDGE_H
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "navigationview.h"
+#include "ruilistmodel.h"
+#include "navigationbridge.h"
+
+#include <QPainter>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QImage>
+
+// Panel geometry, from www/rui.css.
+static const int MAX_PANELS = 4;
+static const int PANEL_LEFT = 8;
+static const int PANEL_TOP = 60;
+static const int PANEL_HEIGHT = 86;
+static const int NUMBER_WIDTH = 65;
+static const int NAME_WIDTH = 400;
+static const int TEXT_TOP = 29;
+static const int TEXT_HEIGHT = 30;
+static const int ICON_LEFT = 9;
+static const int ICON_TOP = 13;
+static const int ICON_WIDTH = 80;
+static const int ICON_HEIGHT = 60;
+static const int NAME_TEXT_LEFT = 106;
+static const int NAME_TEXT_WIDTH = 480;
+static const int TITLE_HEIGHT = 38;
+static const int TITLE_TEXT_LEFT = 84;
+static const int FONT_PIXELS = 25;
+
+NavigationView::NavigationView(RUIListModel* model, NavigationBridge* bridge, QWidget *parent)
+    : QWidget(parent)
+    , m_model(model)
+    , m_bridge(bridge)
+    , m_background(":/www/rui_background_dlna.png")
+    , m_titleWipe(":/www/rui_titleWipe.png")
+    , m_number(":/www/rui_elementNumber.png")
+    , m_numberHighlight(":/www/rui_elementNumberHighlight.png")
+    , m_name(":/www/rui_elementName.png")
+    , m_nameHighlight(":/www/rui_elementNameHighlight.png")
+    , m_missingIcon(":/www/rui_missingIcon.png")
+{
+    setFocusPolicy(Qt::StrongFocus);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    QFont font("Sans-Serif");
+    font.setPixelSize(FONT_PIXELS);
+    setFont(font);
+
+    connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(onDataChanged(QModelIndex,QModelIndex)));
+    connect(m_model, SIGNAL(modelReset()), this, SLOT(onModelReset()));
+}
+
+QRect NavigationView::panelRect(int panel) const
+{
+    return QRect(PANEL_LEFT, PANEL_TOP + panel * PANEL_HEIGHT, NUMBER_WIDTH + NAME_WIDTH, PANEL_HEIGHT);
+}
+
+bool NavigationView::canScroll() const
+{
+    return m_model->rowCount() > MAX_PANELS;
+}
+
+void NavigationView::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+
+    painter.fillRect(rect(), QColor(0x00, 0x49, 0x88));
+    painter.drawPixmap(rect(), m_background);
+
+    painter.setPen(Qt::white);
+    painter.drawPixmap(QRect(0, 0, width(), TITLE_HEIGHT), m_titleWipe);
+    painter.drawText(QRect(TITLE_TEXT_LEFT, 0, width(), TITLE_HEIGHT), Qt::AlignVCenter, "Select a Service");
+
+    int scrollIndex = m_bridge->scrollIndex();
+    int screenIndex = m_bridge->screenIndex();
+
+    for (int i = 0; i < MAX_PANELS; i++) {
+        int row = scrollIndex + i;
+        if (row >= m_model->rowCount())
+            break;
+
+        QRect panel = panelRect(i);
+        bool selected = (i == screenIndex);
+        QModelIndex index = m_model->index(row);
+
+        painter.drawPixmap(panel.topLeft(), selected ? m_numberHighlight : m_number);
+        painter.drawText(QRect(panel.left(), panel.top() + TEXT_TOP, NUMBER_WIDTH, TEXT_HEIGHT),
+                         Qt::AlignCenter, QString::number((row + 1) % 10));
+
+        int nameLeft = panel.left() + NUMBER_WIDTH;
+        painter.drawPixmap(nameLeft, panel.top(), selected ? m_nameHighlight : m_name);
+
+        QImage icon = m_model->data(index, Qt::DecorationRole).value<QImage>();
+        if (icon.isNull())
+            icon = m_missingIcon;
+        QSize iconSize = icon.size().boundedTo(QSize(ICON_WIDTH, ICON_HEIGHT));
+        if (iconSize != icon.size())
+            iconSize = icon.size().scaled(ICON_WIDTH, ICON_HEIGHT, Qt::KeepAspectRatio);
+        painter.drawImage(QRect(QPoint(nameLeft + ICON_LEFT, panel.top() + ICON_TOP), iconSize), icon);
+
+        QRect textRect(nameLeft + NAME_TEXT_LEFT, panel.top() + TEXT_TOP, NAME_TEXT_WIDTH, TEXT_HEIGHT);
+        QString name = m_model->data(index, Qt::DisplayRole).toString();
+        painter.drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+                         painter.fontMetrics().elidedText(name, Qt::ElideRight, textRect.width()));
+    }
+}
+
+// Here when UIs changed. Only repaint the panels showing them.
+void NavigationView::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight)
+{
+    int scrollIndex = m_bridge->scrollIndex();
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+        int panel = row - scrollIndex;
+        if (panel >= 0 && panel < MAX_PANELS)
+            update(panelRect(panel));
+    }
+}
+
+// Here when UIs were added or removed. Keep the highlight on a UI that's still there.
+void NavigationView::onModelReset()
+{
+    int count = m_model->rowCount();
+    int scrollIndex = qBound(0, m_bridge->scrollIndex(), qMax(0, count - MAX_PANELS));
+    int screenIndex = qBound(0, m_bridge->screenIndex(), qMax(0, qMin(MAX_PANELS, count - scrollIndex) - 1));
+
+    if (scrollIndex != m_bridge->scrollIndex())
+        m_bridge->setScrollIndex(scrollIndex);
+    if (screenIndex != m_bridge->screenIndex())
+        m_bridge->setScreenIndex(screenIndex);
+
+    update();
+}
+
+void NavigationView::keyPressEvent(QKeyEvent* event)
+{
+    int scrollIndex = m_bridge->scrollIndex();
+    int screenIndex = m_bridge->screenIndex();
+    int count = m_model->rowCount();
+
+    switch (event->key()) {
+
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        selectUI(scrollIndex + screenIndex);
+        break;
+
+    case Qt::Key_Up:
+        if (screenIndex > 0) {
+            m_bridge->setScreenIndex(screenIndex - 1);
+            recordScreenPosition();
+        } else if (canScroll() && scrollIndex > 0) {
+            m_bridge->setScrollIndex(scrollIndex - 1);
+            recordScreenPosition();
+        }
+        break;
+
+    case Qt::Key_Down:
+        if (screenIndex < (MAX_PANELS - 1) && screenIndex < (count - 1)) {
+            m_bridge->setScreenIndex(screenIndex + 1);
+            recordScreenPosition();
+        } else if (canScroll() && scrollIndex < (count - MAX_PANELS)) {
+            m_bridge->setScrollIndex(scrollIndex + 1);
+            recordScreenPosition();
+        }
+        break;
+
+    default:
+        if (event->key() >= Qt::Key_0 && event->key() <= Qt::Key_9) {
+            int index = numKeyToIndex(event->key() - Qt::Key_0);
+            if (index >= 0 && index < count) {
+                m_bridge->setScreenIndex(index - scrollIndex);
+                recordScreenPosition();
+                selectUI(index);
+            }
+        } else {
+            QWidget::keyPressEvent(event);
+        }
+        break;
+    }
+}
+
+// Here when a panel was clicked.
+void NavigationView::mousePressEvent(QMouseEvent* event)
+{
+    for (int i = 0; i < MAX_PANELS; i++) {
+        if (panelRect(i).contains(event->pos())) {
+            int index = m_bridge->scrollIndex() + i;
+            if (index < m_model->rowCount()) {
+                m_bridge->setScreenIndex(i);
+                recordScreenPosition();
+                selectUI(index);
+            }
+            return;
+        }
+    }
+
+    QWidget::mousePressEvent(event);
+}
+
+int NavigationView::numKeyToIndex(int numKey) const
+{
+    int scrollIndex = m_bridge->scrollIndex();
+
+    for (int i = 0; i < MAX_PANELS; i++) {
+        int index = scrollIndex + i;
+        if (numKey == (index + 1) % 10)
+            return index;
+    }
+
+    return -1;
+}
+
+// Here after the highlight moved. Let the browser warm up a connection to the highlighted RUI.
+void NavigationView::recordScreenPosition()
+{
+    update();
+
+    int index = m_bridge->scrollIndex() + m_bridge->screenIndex();
+    QString uri = m_model->uri(index);
+    if (!uri.isEmpty())
+        m_bridge->highlightUI(uri);
+}
+
+void NavigationView::selectUI(int index)
+{
+    QString uri = m_model->uri(index);
+    if (!uri.isEmpty())
+        m_bridge->selectUI(uri);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef NAVIGATIONVIEW_H
+#define NAVIGATIONVIEW_H
+
+#include <QWidget>
+#include <QImage>
+#include <QPixmap>
+#include <QModelIndex>
+
+class NavigationBridge;
+class RUIListModel;
+
+// Native navigation screen (navigation/native), an alternative to the navigation page
+// (rui:home) that needs no web page, jQuery or JavaScript. It draws the same panels from
+// a RUIListModel and follows rui.js for keys and scrolling: up/down move the highlight and
+// scroll one panel at the end, number keys launch the panel showing that number, enter or a
+// click launches the highlighted UI. The scroll position is kept in the window's
+// NavigationBridge, as it is for the page.
+class NavigationView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    NavigationView(RUIListModel* model, NavigationBridge* bridge, QWidget *parent = 0);
+
+protected:
+    void paintEvent(QPaintEvent* event);
+    void keyPressEvent(QKeyEvent* event);
+    void mousePressEvent(QMouseEvent* event);
+
+private slots:
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+    void onModelReset();
+
+private:
+    QRect panelRect(int panel) const;
+    int numKeyToIndex(int numKey) const;
+    bool canScroll() const;
+    void recordScreenPosition();
+    void selectUI(int index);
+
+    RUIListModel* m_model;
+    NavigationBridge* m_bridge;
+
+    QPixmap m_background;
+    QPixmap m_titleWipe;
+    QPixmap m_number;
+    QPixmap m_numberHighlight;
+    QPixmap m_name;
+    QPixmap m_nameHighlight;
+    QImage m_missingIcon;
+};
+
+#endif // NAVIGATIONVIEW_H
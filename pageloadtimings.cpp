@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pageloadtimings.h"
+
+#include <stdio.h>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// Here to keep the history bounded: timelines kept per URI, and URIs kept overall.
+static const int MAX_TIMELINES_PER_URI = 16;
+static const int MAX_URIS = 64;
+
+PageLoadTimings* PageLoadTimings::m_pInstance = NULL;
+
+PageLoadTimeline::PageLoadTimeline()
+    : visible(false)
+    , ok(false)
+    , firstByte(-1)
+    , domContentLoaded(-1)
+    , firstLayout(-1)
+    , loadFinished(-1)
+    , resources(0)
+    , bytes(0)
+{
+}
+
+QVariantMap PageLoadTimeline::toVariantMap() const
+{
+    QVariantMap map;
+    map["uri"] = uri;
+    map["started"] = started.toString(Qt::ISODate);
+    map["visible"] = visible;
+    map["ok"] = ok;
+    map["firstByte"] = firstByte;
+    map["domContentLoaded"] = domContentLoaded;
+    map["firstLayout"] = firstLayout;
+    map["loadFinished"] = loadFinished;
+    map["resources"] = resources;
+    map["bytes"] = bytes;
+    map["performanceTiming"] = performanceTiming;
+    return map;
+}
+
+PageLoadTimings::PageLoadTimings()
+{
+}
+
+PageLoadTimings* PageLoadTimings::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new PageLoadTimings;
+    }
+
+    return m_pInstance;
+}
+
+void PageLoadTimings::record(const PageLoadTimeline& timeline)
+{
+    QList<PageLoadTimeline>& list = m_timelines[timeline.uri];
+    list.append(timeline);
+    while (list.count() > MAX_TIMELINES_PER_URI) {
+        list.removeFirst();
+    }
+
+    m_uris.removeOne(timeline.uri);
+    m_uris.append(timeline.uri);
+    while (m_uris.count() > MAX_URIS) {
+        m_timelines.remove(m_uris.takeFirst());
+    }
+}
+
+QList<PageLoadTimeline> PageLoadTimings::timelines(const QString& uri) const
+{
+    return m_timelines.value(uri);
+}
+
+void PageLoadTimings::clear()
+{
+    m_timelines.clear();
+    m_uris.clear();
+}
+
+void PageLoadTimings::dump()
+{
+    fprintf(stderr, "Page load timings (ms since load started, -1 if not reached):\n");
+
+    foreach (const QString& uri, m_uris) {
+        fprintf(stderr, "%s\n", uri.toUtf8().data());
+        foreach (const PageLoadTimeline& t, m_timelines.value(uri)) {
+            fprintf(stderr, "  %s %s%s first byte %lld, DOMContentLoaded %lld, first layout %lld, finished %lld, %d resources, %lld KB\n",
+                    t.started.toString("hh:mm:ss").toUtf8().data(),
+                    t.ok ? "ok" : "failed",
+                    t.visible ? "" : " (off-screen)",
+                    t.firstByte, t.domContentLoaded, t.firstLayout, t.loadFinished,
+                    t.resources, t.bytes / 1024);
+        }
+    }
+}
+
+// { "<uri>": [ timeline, ... ], ... }, oldest timeline first.
+QByteArray PageLoadTimings::toJson() const
+{
+    QJsonObject object;
+
+    foreach (const QString& uri, m_uris) {
+        QJsonArray array;
+        foreach (const PageLoadTimeline& t, m_timelines.value(uri)) {
+            array.append(QJsonObject::fromVariantMap(t.toVariantMap()));
+        }
+        object.insert(uri, array);
+    }
+
+    return QJsonDocument(object).toJson();
+}
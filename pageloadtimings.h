@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PAGELOADTIMINGS_H
+#define PAGELOADTIMINGS_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+// One page load, as seen by RUIWebPage. Milestones are milliseconds since loadStarted, or -1
+// if the milestone wasn't reached (or, for DOMContentLoaded, the page didn't report it).
+struct PageLoadTimeline
+{
+    PageLoadTimeline();
+
+    QString uri;
+    QDateTime started;
+    bool visible;           // false for pages loaded off-screen (prerender)
+    bool ok;
+    qint64 firstByte;
+    qint64 domContentLoaded;
+    qint64 firstLayout;
+    qint64 loadFinished;
+    int resources;
+    qint64 bytes;
+    QVariantMap performanceTiming;  // window.performance.timing, as reported by the page
+
+    QVariantMap toVariantMap() const;
+};
+
+// The PageLoadTimings keeps the most recent page load timelines for each URI, so RUI launch
+// latency can be looked at after the fact. Timelines are dumped from the Debug menu, or
+// exported as JSON.
+class PageLoadTimings : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PageLoadTimings* Instance();
+
+    void record(const PageLoadTimeline& timeline);
+    QList<PageLoadTimeline> timelines(const QString& uri) const;
+    void clear();
+
+    void dump();
+    QByteArray toJson() const;
+
+private:
+    PageLoadTimings();
+    static PageLoadTimings* m_pInstance;
+
+    QHash<QString, QList<PageLoadTimeline> > m_timelines;  // oldest first
+    QStringList m_uris;  // least recently loaded first
+};
+
+#endif // PAGELOADTIMINGS_H
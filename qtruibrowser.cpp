@@ -23,46 +23,83 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include "browsersettings.h"
 #include "mainwindow.h"
+#include "memorygovernor.h"
+#include "memorypressuremonitor.h"
+#include "ruichild.h"
+#include "ruinetworkaccessmanager.h"
+#include "startuptrace.h"
+#include "tracerecorder.h"
 
 #include <QApplication>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QFontDatabase>
+#include <QScreen>
 #include <QSettings>
 #include <QTextStream>
+#include <QWebSecurityOrigin>
 
 
 static void printUsage(const QString& program)
 {
-    QTextStream(stderr) << "Usage: " << program << " [-h | --help] [--fullscreen] [url]" << endl;
+    QTextStream(stderr) << "Usage: " << program << " [-h | --help] [--fullscreen] [--benchmark-launch] [--trace file] [--memory-pressure level] [--startup-trace] [--benchmark-startup] [--screens] [--rui-child server] [url]" << endl;
 }
 
 static void applyDefaultSettings()
 {
+    // Everything below reads the settings, so load them first, on their own.
+    BrowserSettings::Instance();
+    StartupTrace::mark("settings loaded");
 
-    QWebSettings::setMaximumPagesInCache(4);
-
-    QWebSettings::setObjectCacheCapacities((16*1024*1024) / 8, (16*1024*1024) / 8, 16*1024*1024);
+    // Page and object cache sizes are set (and retuned) by the MemoryGovernor.
+    MemoryGovernor::Instance()->start();
 
     QWebSettings::globalSettings()->setAttribute(QWebSettings::PluginsEnabled, true);
     QWebSettings::globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, true);
     QWebSettings::globalSettings()->setAttribute(QWebSettings::AcceleratedCompositingEnabled, true);
     QWebSettings::enablePersistentStorage();
+
+    // rui:home is served by the browser and loads its resources from qrc:, like a local file.
+    QWebSecurityOrigin::addLocalScheme("rui");
 }
 
 int main(int argc, char **argv)
 {
+    StartupTrace::start();
+
     QApplication app(argc, argv);
 
     const QStringList& args = app.arguments();
     bool startFullScreen = false;
+    bool benchmarkLaunch = false;
+    QString traceFile;
+    int memoryPressure = -1;
+    bool startupTrace = false;
+    bool benchmarkStartup = false;
+    bool allScreens = false;
+    QString childServer;
     QString uri;
     for (int i = 1; i < args.size(); ++i) {
         const QString& arg = args[i];
         if (arg == "--fullscreen") {
             startFullScreen = true;
+        } else if (arg == "--benchmark-launch") {
+            benchmarkLaunch = true;
+        } else if (arg == "--trace" && i + 1 < args.size()) {
+            traceFile = args[++i];
+        } else if (arg == "--memory-pressure" && i + 1 < args.size()) {
+            memoryPressure = args[++i].toInt();
+        } else if (arg == "--startup-trace") {
+            startupTrace = true;
+        } else if (arg == "--benchmark-startup") {
+            benchmarkStartup = true;
+        } else if (arg == "--screens") {
+            allScreens = true;
+        } else if (arg == "--rui-child" && i + 1 < args.size()) {
+            childServer = args[++i];
         } else if (arg == "--help" || arg == "-h") {
             printUsage(args[0]);
             return 1;
@@ -74,21 +111,80 @@ int main(int argc, char **argv)
             return 1;\
         }
     }
+
+    // Trace from the start; the trace is written when the application exits.
+    if (!traceFile.isEmpty())
+        TraceRecorder::Instance()->setEnabled(true);
+
+    StartupTrace::setEnabled(startupTrace);
+    StartupTrace::mark("application created");
+
     applyDefaultSettings();
+    StartupTrace::mark("default settings applied");
 
     app.setOrganizationName("CableLabs");
     app.setApplicationName("QtRUIBrowser");
     app.setApplicationVersion("0.1");
 
+    // Started by a browser with performance/processPerRUI, to show its RUIs (see RUIProcessHost).
+    // The HTTP disk cache belongs to the browser; two processes can't share its directory.
+    if (!childServer.isEmpty()) {
+        RUINetworkAccessManager::setDiskCacheEnabled(false);
+        RUIChild child(childServer);
+        if (!child.start())
+            return 1;
+        return app.exec();
+    }
+
     MainWindow window(startFullScreen);
+    StartupTrace::mark("main window created");
+
+    // Report the time to the first paint of the navigation page, and exit.
+    if (benchmarkStartup)
+        window.benchmarkStartup();
 
-    if (!uri.isEmpty()) {
+    // Synthetic pressure (0 none .. 4 critical), to test how memory is shed.
+    MemoryPressureMonitor* pressureMonitor = MemoryPressureMonitor::Instance();
+    if (memoryPressure >= 0)
+        pressureMonitor->setSyntheticLevel(memoryPressure);
+    pressureMonitor->start();
+
+    if (benchmarkLaunch) {
+        // Launch uri from the navigation page, as a user would, and time it.
+        if (uri.isEmpty()) {
+            QTextStream(stderr) << "Error: --benchmark-launch requires a url" << endl;
+            return 1;
+        }
+        window.home();
+        window.benchmarkLaunch(uri);
+    } else if (!uri.isEmpty()) {
         window.load(uri);
     } else {
         window.home();
     }
     window.show();
     window.checkHttpProxyEnabled();
+    StartupTrace::mark("main window shown");
+
+    // One more window for every other screen, each with its own navigation page. They share the
+    // discovery and catalogue of the first.
+    if (allScreens) {
+        foreach (QScreen* screen, app.screens()) {
+            if (screen == app.primaryScreen())
+                continue;
+
+            MainWindow* screenWindow = new MainWindow(startFullScreen);
+            screenWindow->setAttribute(Qt::WA_DeleteOnClose);
+            screenWindow->move(screen->availableGeometry().topLeft());
+            screenWindow->home();
+            screenWindow->show();
+        }
+    }
+
+    int result = app.exec();
+
+    if (!traceFile.isEmpty())
+        TraceRecorder::Instance()->save(traceFile);
 
-    return app.exec();
+    return result;
 }
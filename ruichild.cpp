@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruichild.h"
+#include "memorygovernor.h"
+
+#include <stdio.h>
+#include <QApplication>
+#include <QKeyEvent>
+#include <QWebView>
+#include <QWebFrame>
+
+static const int CONNECT_TIMEOUT_MS = 5000;
+
+RUIChild::RUIChild(const QString& serverName, QObject *parent)
+    : QObject(parent)
+    , m_serverName(serverName)
+    , m_view(0)
+    , m_page(0)
+{
+    connect(&m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(&m_socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+}
+
+RUIChild::~RUIChild()
+{
+    delete m_view;
+}
+
+// Here to connect to the browser and offer our window. Returns false if the browser can't be
+// reached.
+bool RUIChild::start()
+{
+    m_socket.connectToServer(m_serverName);
+    if (!m_socket.waitForConnected(CONNECT_TIMEOUT_MS)) {
+        fprintf(stderr, "RUI child: unable to connect to %s: %s\n",
+                m_serverName.toUtf8().data(), m_socket.errorString().toUtf8().data());
+        return false;
+    }
+
+    m_view = new QWebView;
+    m_view->setWindowFlags(Qt::FramelessWindowHint);
+    m_page = new ChildWebPage(m_view);
+    m_view->setPage(m_page);
+    m_view->installEventFilter(this);
+
+    connect(m_page, SIGNAL(loadFinished(bool)), this, SLOT(onLoadFinished(bool)));
+    connect(m_page->mainFrame(), SIGNAL(titleChanged(QString)), this, SLOT(onTitleChanged(QString)));
+    connect(m_page->mainFrame(), SIGNAL(urlChanged(QUrl)), this, SLOT(onUrlChanged(QUrl)));
+
+    // The window must exist (and be mapped) before the browser can embed it.
+    m_view->show();
+    send("hello", QString::number(quint64(m_view->winId())));
+    return true;
+}
+
+// Here when the browser went away (or crashed). Nothing to show anymore.
+void RUIChild::onDisconnected()
+{
+    QApplication::quit();
+}
+
+void RUIChild::send(const char* message, const QString& argument)
+{
+    QByteArray line(message);
+    if (!argument.isEmpty()) {
+        QString text = argument;
+        line += ' ' + text.replace('\n', ' ').toUtf8();
+    }
+    line += '\n';
+
+    m_socket.write(line);
+    m_socket.flush();
+}
+
+void RUIChild::onReadyRead()
+{
+    while (m_socket.canReadLine()) {
+        QByteArray line = m_socket.readLine().trimmed();
+        int space = line.indexOf(' ');
+        QByteArray message = (space < 0) ? line : line.left(space);
+        QString argument = (space < 0) ? QString() : QString::fromUtf8(line.mid(space + 1));
+        handleMessage(message, argument);
+    }
+}
+
+void RUIChild::handleMessage(const QByteArray& message, const QString& argument)
+{
+    if (message == "load") {
+        // "load <0|1> <url>": whether the host is a RUI transport server, and the URL.
+        QUrl url(argument.section(' ', 1));
+        if (argument.section(' ', 0, 0) == "1")
+            m_page->addTransportServer(url.host());
+        m_page->mainFrame()->load(url);
+        m_view->setFocus();
+    } else if (message == "ping") {
+        send("pong", QString::number(MemoryGovernor::residentMemory()));
+    } else if (message == "quit") {
+        QApplication::quit();
+    }
+}
+
+void RUIChild::onLoadFinished(bool ok)
+{
+    send("loaded", ok ? "1" : "0");
+}
+
+void RUIChild::onTitleChanged(const QString& title)
+{
+    send("title", title);
+}
+
+void RUIChild::onUrlChanged(const QUrl& url)
+{
+    send("url", url.toString());
+}
+
+// Escape (home) belongs to the browser. Keys go to our window while it's embedded, so pass it on.
+bool RUIChild::eventFilter(QObject* object, QEvent* event)
+{
+    if (event->type() == QEvent::KeyPress && ((QKeyEvent*)event)->key() == Qt::Key_Escape) {
+        send("home");
+        return true;
+    }
+
+    return QObject::eventFilter(object, event);
+}
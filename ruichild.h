@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUICHILD_H
+#define RUICHILD_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QSet>
+#include <QUrl>
+
+#include "ruiwebpage.h"
+
+class QWebView;
+
+// Page of a RUI child process. There is no catalogue in the child, so the parent says with each
+// load whether the host is a RUI transport server.
+class ChildWebPage : public RUIWebPage
+{
+    Q_OBJECT
+
+public:
+    ChildWebPage(QObject* parent = 0) : RUIWebPage(parent) {}
+
+    void addTransportServer(const QString& host) { m_transportServers.insert(host); }
+
+protected:
+    virtual bool isHostRUITransportServer(const QString& host) const { return m_transportServers.contains(host); }
+
+private:
+    QSet<QString> m_transportServers;
+};
+
+// The child side of process-per-RUI (--rui-child): a bare web view that connects back to the
+// RUIProcessHost of the browser that started it, hands over its window for embedding, and
+// loads what it's told to. It exits when the browser goes away. See RUIProcessHost for the
+// protocol.
+class RUIChild : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RUIChild(const QString& serverName, QObject *parent = 0);
+    ~RUIChild();
+
+    bool start();
+
+protected:
+    bool eventFilter(QObject* object, QEvent* event);
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+    void onLoadFinished(bool ok);
+    void onTitleChanged(const QString& title);
+    void onUrlChanged(const QUrl& url);
+
+private:
+    void send(const char* message, const QString& argument = QString());
+    void handleMessage(const QByteArray& message, const QString& argument);
+
+    QString m_serverName;
+    QLocalSocket m_socket;
+    QWebView* m_view;
+    ChildWebPage* m_page;
+};
+
+#endif // RUICHILD_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruilistmodel.h"
+#include "navigationbridge.h"
+#include "iconcache.h"
+
+#include <QImage>
+#include <QUrl>
+
+RUIListModel::RUIListModel(NavigationBridge* bridge, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_bridge(bridge)
+{
+    connect(m_bridge, SIGNAL(ruiListNotification()), this, SLOT(refresh()));
+    connect(IconCache::Instance(), SIGNAL(iconReady(QString)), this, SLOT(onIconReady(QString)));
+    refresh();
+}
+
+int RUIListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_uis.count();
+}
+
+QVariant RUIListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_uis.count())
+        return QVariant();
+
+    QVariantMap ui = m_uis[index.row()].toMap();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return ui.value("name");
+    case Qt::ToolTipRole:
+        return ui.value("description");
+    case Qt::DecorationRole: {
+        // Scaled to panel size by the icon cache. Fetched on first use; onIconReady() reports it.
+        QString key = iconKey(index.row());
+        if (key.isEmpty())
+            return QVariant();
+        QImage image = IconCache::Instance()->iconImage(key);
+        if (image.isNull()) {
+            IconCache::Instance()->fetch(key);
+            return QVariant();
+        }
+        return image;
+    }
+    case KeyRole:
+        return ui.value("key");
+    case UriRole:
+        return uri(index.row());
+    }
+
+    return QVariant();
+}
+
+QString RUIListModel::uri(int row) const
+{
+    if (row < 0 || row >= m_uis.count())
+        return QString();
+
+    QVariantList protocolList = m_uis[row].toMap().value("protocolList").toList();
+    if (protocolList.isEmpty())
+        return QString();
+
+    QStringList uriList = protocolList.first().toMap().value("uriList").toStringList();
+    return uriList.isEmpty() ? QString() : uriList.first();
+}
+
+QString RUIListModel::iconKey(int row) const
+{
+    QString iconURL = m_uis[row].toMap().value("iconURL").toString();
+    if (!iconURL.startsWith("rui-icon:"))
+        return QString();
+
+    return IconCache::keyForURL(QUrl(iconURL));
+}
+
+// Here with an updated list of RUIs.
+void RUIListModel::refresh()
+{
+    QVariantList uis = m_bridge->ruiList();
+
+    bool sameKeys = (uis.count() == m_uis.count());
+    for (int i = 0; sameKeys && i < uis.count(); i++) {
+        if (uis[i].toMap().value("key") != m_uis[i].toMap().value("key"))
+            sameKeys = false;
+    }
+
+    if (!sameKeys) {
+        beginResetModel();
+        m_uis = uis;
+        endResetModel();
+        return;
+    }
+
+    QList<int> changed;
+    for (int i = 0; i < uis.count(); i++) {
+        if (uis[i].toMap().value("revision") != m_uis[i].toMap().value("revision"))
+            changed.append(i);
+    }
+
+    m_uis = uis;
+    foreach (int row, changed) {
+        emit dataChanged(index(row), index(row));
+    }
+}
+
+void RUIListModel::onIconReady(const QString& key)
+{
+    for (int i = 0; i < m_uis.count(); i++) {
+        if (iconKey(i) == key)
+            emit dataChanged(index(i), index(i));
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUILISTMODEL_H
+#define RUILISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVariantList>
+
+class NavigationBridge;
+
+// List model over the discovered RUIs, for the native navigation screen. Rows are the UIs in
+// the order the navigation page shows them. On a catalogue change only rows whose UI changed
+// are reported (by key and revision, see UserInterfaceMap::generateUIListDelta()); the model is
+// reset when UIs were added, removed or reordered.
+class RUIListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        KeyRole = Qt::UserRole + 1,
+        UriRole
+    };
+
+    explicit RUIListModel(NavigationBridge* bridge, QObject *parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+
+    // The URI a UI is launched with (the first URI of its first protocol).
+    QString uri(int row) const;
+
+public slots:
+    void refresh();
+
+private slots:
+    void onIconReady(const QString& key);
+
+private:
+    QString iconKey(int row) const;
+
+    NavigationBridge* m_bridge;
+    QVariantList m_uis;
+};
+
+#endif // RUILISTMODEL_H
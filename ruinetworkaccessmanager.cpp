@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruinetworkaccessmanager.h"
+#include "iconcache.h"
+#include "iconatlas.h"
+#include "harrecorder.h"
+#include "browsersettings.h"
+#include "homepage.h"
+#include "navigationbridge.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <QFile>
+#include <QNetworkDiskCache>
+#include <QTimer>
+#include <QWebFrame>
+#include <QWebPage>
+
+static const char* icon_scheme = "rui-icon";
+static const char* home_url = "rui:home";
+const char* navigation_bridge_property = "navigationBridge";
+static const char* missing_icon = ":/www/rui_missingIcon.png";
+
+// Property used to hand each reply's byte count from downloadProgress() to finished().
+static const char* cacheBytesProperty = "ruiCacheBytes";
+
+RUINetworkAccessManager* RUINetworkAccessManager::m_pInstance = NULL;
+bool RUINetworkAccessManager::m_diskCacheEnabled = true;
+
+RUINetworkAccessManager::RUINetworkAccessManager(QObject *parent)
+    : QNetworkAccessManager(parent)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
+    , m_cacheHitBytes(0)
+    , m_cacheMissBytes(0)
+{
+}
+
+RUINetworkAccessManager* RUINetworkAccessManager::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new RUINetworkAccessManager;
+        m_pInstance->enableDiskCache();
+    }
+
+    return m_pInstance;
+}
+
+void RUINetworkAccessManager::setDiskCacheEnabled(bool enabled)
+{
+    m_diskCacheEnabled = enabled;
+}
+
+void RUINetworkAccessManager::enableDiskCache()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+    if (!m_diskCacheEnabled || !settings->httpCacheEnabled || settings->httpCacheDirectory.isEmpty())
+        return;
+
+    QNetworkDiskCache* cache = new QNetworkDiskCache(this);
+    cache->setCacheDirectory(settings->httpCacheDirectory);
+    cache->setMaximumCacheSize(qint64(settings->httpCacheMaxKB) * 1024);
+    setCache(cache);
+}
+
+void RUINetworkAccessManager::clearCache()
+{
+    if (cache()) {
+        cache()->clear();
+        fprintf(stderr, "HTTP cache cleared\n");
+    }
+}
+
+void RUINetworkAccessManager::dumpCacheStatistics()
+{
+    QNetworkDiskCache* diskCache = qobject_cast<QNetworkDiskCache*>(cache());
+    if (!diskCache) {
+        fprintf(stderr, "HTTP cache: disabled\n");
+        return;
+    }
+
+    int requests = m_cacheHits + m_cacheMisses;
+    fprintf(stderr, "HTTP cache: %s, %lld of %lld KB used\n",
+            diskCache->cacheDirectory().toUtf8().data(),
+            diskCache->cacheSize() / 1024, diskCache->maximumCacheSize() / 1024);
+    fprintf(stderr, "- hits: %d (%.1f%%), %lld KB\n", m_cacheHits,
+            requests ? (100.0 * m_cacheHits) / requests : 0.0, m_cacheHitBytes / 1024);
+    fprintf(stderr, "- misses: %d, %lld KB from the network\n", m_cacheMisses, m_cacheMissBytes / 1024);
+}
+
+void RUINetworkAccessManager::onReplyDownloadProgress(qint64 received, qint64)
+{
+    sender()->setProperty(cacheBytesProperty, received);
+}
+
+void RUINetworkAccessManager::onReplyFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || reply->error() != QNetworkReply::NoError)
+        return;
+
+    qint64 bytes = reply->property(cacheBytesProperty).toLongLong();
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+        m_cacheHits++;
+        m_cacheHitBytes += bytes;
+    } else {
+        m_cacheMisses++;
+        m_cacheMissBytes += bytes;
+    }
+}
+
+QNetworkReply* RUINetworkAccessManager::createRequest(Operation op, const QNetworkRequest& request, QIODevice* outgoingData)
+{
+    QNetworkReply* reply;
+    if (op == GetOperation && request.url().scheme() == icon_scheme) {
+        reply = new IconReply(request, this);
+    } else if (op == GetOperation && request.url().toString() == home_url) {
+        reply = new HomeReply(request, this);
+    } else {
+        reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+        // Only cacheable (http) requests count towards the cache statistics.
+        if (cache() && op == GetOperation) {
+            connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(onReplyDownloadProgress(qint64, qint64)));
+            connect(reply, SIGNAL(finished()), this, SLOT(onReplyFinished()));
+        }
+    }
+
+    HarRecorder* har = HarRecorder::Instance();
+    if (har->isRecording())
+        har->track(reply, op, request, outgoingData ? outgoingData->size() : 0);
+
+    emit replyCreated(reply);
+    return reply;
+}
+
+ContentReply::ContentReply(const QNetworkRequest& request, QObject *parent)
+    : QNetworkReply(parent)
+    , m_offset(0)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+void ContentReply::setContent(const QByteArray& content, const char* contentType)
+{
+    m_content = content;
+    m_offset = 0;
+
+    setHeader(QNetworkRequest::ContentTypeHeader, QVariant(contentType));
+    setHeader(QNetworkRequest::ContentLengthHeader, QVariant(m_content.size()));
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+
+    // Signals must not be emitted before the caller has had a chance to connect to them.
+    QTimer::singleShot(0, this, SLOT(complete()));
+}
+
+void ContentReply::complete()
+{
+    emit metaDataChanged();
+    emit downloadProgress(m_content.size(), m_content.size());
+    emit readyRead();
+    emit finished();
+}
+
+void ContentReply::abort()
+{
+    close();
+}
+
+qint64 ContentReply::bytesAvailable() const
+{
+    return m_content.size() - m_offset + QNetworkReply::bytesAvailable();
+}
+
+qint64 ContentReply::readData(char* data, qint64 maxSize)
+{
+    if (m_offset >= m_content.size())
+        return -1;
+
+    qint64 count = qMin(maxSize, m_content.size() - m_offset);
+    memcpy(data, m_content.constData() + m_offset, count);
+    m_offset += count;
+    return count;
+}
+
+IconReply::IconReply(const QNetworkRequest& request, QObject *parent)
+    : ContentReply(request, parent)
+    , m_key(IconCache::keyForURL(request.url()))
+{
+    IconCache* cache = IconCache::Instance();
+    QByteArray data;
+
+    if (m_key == IconAtlas::atlasKey) {
+        connect(IconAtlas::Instance(), SIGNAL(pngReady(QByteArray)), this, SLOT(onAtlasReady(QByteArray)));
+        if (IconAtlas::Instance()->png(&data))
+            setIcon(data);
+    } else if (cache->iconData(m_key, &data)) {
+        setIcon(data);
+    } else {
+        connect(cache, SIGNAL(iconReady(QString)), this, SLOT(onIconReady(QString)));
+        connect(cache, SIGNAL(iconFailed(QString)), this, SLOT(onIconFailed(QString)));
+        cache->fetch(m_key);
+    }
+}
+
+void IconReply::onIconReady(const QString& key)
+{
+    if (key != m_key)
+        return;
+
+    QByteArray data;
+    if (IconCache::Instance()->iconData(m_key, &data)) {
+        setIcon(data);
+    } else {
+        onIconFailed(key);
+    }
+}
+
+void IconReply::onIconFailed(const QString& key)
+{
+    if (key != m_key)
+        return;
+
+    QFile file(missing_icon);
+    file.open(QIODevice::ReadOnly);
+    setIcon(file.readAll());
+}
+
+void IconReply::onAtlasReady(const QByteArray& png)
+{
+    setIcon(png);
+}
+
+void IconReply::setIcon(const QByteArray& png)
+{
+    disconnect(IconCache::Instance(), 0, this, 0);
+    disconnect(IconAtlas::Instance(), 0, this, 0);
+    setContent(png, "image/png");
+}
+
+void IconReply::abort()
+{
+    disconnect(IconCache::Instance(), 0, this, 0);
+    disconnect(IconAtlas::Instance(), 0, this, 0);
+    ContentReply::abort();
+}
+
+// The page is rendered at the position of the navigation page of the window it's loaded in. The
+// window's NavigationBridge is found through the page's navigationBridge property.
+HomeReply::HomeReply(const QNetworkRequest& request, QObject *parent)
+    : ContentReply(request, parent)
+{
+    int scrollIndex = 0;
+    int screenIndex = 0;
+
+    QWebFrame* frame = qobject_cast<QWebFrame*>(request.originatingObject());
+    if (frame && frame->page()) {
+        NavigationBridge* bridge = qobject_cast<NavigationBridge*>(frame->page()->property(navigation_bridge_property).value<QObject*>());
+        if (bridge) {
+            scrollIndex = bridge->scrollIndex();
+            screenIndex = bridge->screenIndex();
+        }
+    }
+
+    setContent(HomePage::render(scrollIndex, screenIndex), "text/html; charset=utf-8");
+}
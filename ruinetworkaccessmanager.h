@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUINETWORKACCESSMANAGER_H
+#define RUINETWORKACCESSMANAGER_H
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+// Network access manager used by RUIWebPage and DiscoveryProxy. Serves the browser's internal
+// schemes (rui-icon:// and rui:home) and passes everything else to QNetworkAccessManager. Requests are
+// recorded by the HarRecorder while it is recording.
+//
+// All pages share Instance(), which has the HTTP disk cache (a QNetworkDiskCache can only
+// belong to one manager), so RUI assets are loaded from disk on the next launch.
+class RUINetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    explicit RUINetworkAccessManager(QObject *parent = 0);
+    static RUINetworkAccessManager* Instance();
+
+    // Here for RUI child processes (--rui-child), which must leave the browser's disk cache alone.
+    // Only has an effect before Instance() is first called.
+    static void setDiskCacheEnabled(bool enabled);
+
+    void clearCache();
+    void dumpCacheStatistics();
+
+signals:
+    // Emitted for every request, before the reply has produced any data.
+    void replyCreated(QNetworkReply* reply);
+
+protected:
+    virtual QNetworkReply* createRequest(Operation op, const QNetworkRequest& request, QIODevice* outgoingData = 0);
+
+private slots:
+    void onReplyDownloadProgress(qint64 received, qint64 total);
+    void onReplyFinished();
+
+private:
+    static RUINetworkAccessManager* m_pInstance;
+    static bool m_diskCacheEnabled;
+    void enableDiskCache();
+
+    // HTTP cache statistics, for Instance()
+    int m_cacheHits;
+    int m_cacheMisses;
+    qint64 m_cacheHitBytes;
+    qint64 m_cacheMissBytes;
+};
+
+// Reply with content produced by the browser itself. The content is handed out once the caller
+// had a chance to connect to the reply's signals.
+class ContentReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    ContentReply(const QNetworkRequest& request, QObject *parent = 0);
+
+    virtual void abort();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const { return true; }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+    void setContent(const QByteArray& content, const char* contentType);
+
+private slots:
+    void complete();
+
+private:
+    QByteArray m_content;
+    qint64 m_offset;
+};
+
+// Reply for a rui-icon:// URL. Completes as soon as the IconCache has the icon, and falls back to
+// the bundled missing icon if it can't be fetched. rui-icon://atlas/<generation> is the IconAtlas.
+class IconReply : public ContentReply
+{
+    Q_OBJECT
+
+public:
+    IconReply(const QNetworkRequest& request, QObject *parent = 0);
+
+    virtual void abort();
+
+private slots:
+    void onIconReady(const QString& key);
+    void onIconFailed(const QString& key);
+    void onAtlasReady(const QByteArray& png);
+
+private:
+    void setIcon(const QByteArray& png);
+
+    QString m_key;
+};
+
+// Page property holding the window's NavigationBridge, for rendering rui:home.
+extern const char* navigation_bridge_property;
+
+// Reply for rui:home, the navigation page rendered from the current catalogue (see HomePage).
+class HomeReply : public ContentReply
+{
+    Q_OBJECT
+
+public:
+    HomeReply(const QNetworkRequest& request, QObject *parent = 0);
+};
+
+#endif // RUINETWORKACCESSMANAGER_H
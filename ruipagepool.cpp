@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruipagepool.h"
+#include "ruiwebpage.h"
+#include "browsersettings.h"
+
+#include <stdio.h>
+#include <QWebSettings>
+
+// Pause media before the page goes to the background; a hidden RUI should not keep playing.
+static const char* pauseMediaScript =
+    "(function() {"
+    "    var media = document.querySelectorAll('video, audio');"
+    "    for (var i = 0; i < media.length; i++) media[i].pause();"
+    "})()";
+
+RUIPagePool::RUIPagePool(QObject *parent)
+    : QObject(parent)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+{
+}
+
+RUIPagePool::~RUIPagePool()
+{
+    clear();
+}
+
+bool RUIPagePool::isEnabled() const
+{
+    return BrowserSettings::Instance()->pagePoolSize > 0;
+}
+
+// There is no API for the memory held by a page, so approximate it with the bytes the page
+// has loaded (documents, scripts, images). Good enough to keep heavy RUIs from piling up.
+qint64 RUIPagePool::estimatedMemory(RUIWebPage* page)
+{
+    return page->totalBytes();
+}
+
+qint64 RUIPagePool::totalMemory()
+{
+    qint64 total = 0;
+    foreach (const Entry& entry, m_entries) {
+        total += estimatedMemory(entry.page);
+    }
+    return total;
+}
+
+void RUIPagePool::put(const QUrl& url, RUIWebPage* page)
+{
+    // A page for the same RUI is replaced.
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries[i].url == url) {
+            m_entries.takeAt(i).page->deleteLater();
+            break;
+        }
+    }
+
+    suspend(page);
+
+    Entry entry;
+    entry.url = url;
+    entry.page = page;
+    m_entries.prepend(entry);
+
+    evict();
+}
+
+RUIWebPage* RUIPagePool::take(const QUrl& url)
+{
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries[i].url == url) {
+            RUIWebPage* page = m_entries.takeAt(i).page;
+            resume(page);
+            m_hits++;
+            return page;
+        }
+    }
+
+    m_misses++;
+    return 0;
+}
+
+void RUIPagePool::evict()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+    qint64 budget = qint64(settings->pagePoolMemoryKB) * 1024;
+
+    while (!m_entries.isEmpty() && (m_entries.count() > settings->pagePoolSize || totalMemory() > budget)) {
+        Entry entry = m_entries.takeLast();
+        fprintf(stderr, "Page pool: evicting %s (%lld KB)\n",
+                entry.url.toString().toUtf8().data(), estimatedMemory(entry.page) / 1024);
+        entry.page->deleteLater();
+        m_evictions++;
+    }
+}
+
+void RUIPagePool::clear()
+{
+    foreach (const Entry& entry, m_entries) {
+        entry.page->deleteLater();
+    }
+    m_entries.clear();
+}
+
+// Stop the page from running while it's in the background: media is paused, the page is told
+// it is hidden, and script execution is disabled (timers still fire, but run nothing).
+void RUIPagePool::suspend(RUIWebPage* page)
+{
+    page->mainFrame()->evaluateJavaScript(pauseMediaScript);
+    page->setVisibilityState(QWebPage::VisibilityStateHidden);
+    page->settings()->setAttribute(QWebSettings::JavascriptEnabled, false);
+}
+
+void RUIPagePool::resume(RUIWebPage* page)
+{
+    page->settings()->setAttribute(QWebSettings::JavascriptEnabled, true);
+    page->setVisibilityState(QWebPage::VisibilityStateVisible);
+}
+
+void RUIPagePool::dump()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+    int lookups = m_hits + m_misses;
+
+    fprintf(stderr, "\nRUI page pool: %d/%d pages, %lld/%d KB\n",
+            m_entries.count(), settings->pagePoolSize, totalMemory() / 1024, settings->pagePoolMemoryKB);
+    fprintf(stderr, "- hits: %d, misses: %d (hit rate %.0f%%), evictions: %d\n",
+            m_hits, m_misses, lookups ? (100.0 * m_hits) / lookups : 0.0, m_evictions);
+
+    foreach (const Entry& entry, m_entries) {
+        fprintf(stderr, "- %s: %lld KB\n", entry.url.toString().toUtf8().data(), estimatedMemory(entry.page) / 1024);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUIPAGEPOOL_H
+#define RUIPAGEPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QUrl>
+
+class RUIWebPage;
+
+// A pool of live RUI pages, keyed by the RUI URI they were opened with. Pages parked here
+// (when the user returns to the navigation page) are suspended, and resumed when the same RUI
+// is selected again, so the RUI keeps its state instead of being reloaded. The least recently
+// used page is evicted when the pool exceeds its page count or memory budget.
+class RUIPagePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RUIPagePool(QObject *parent = 0);
+    ~RUIPagePool();
+
+    bool isEnabled() const;
+
+    // Takes ownership of page. It may be evicted right away if it doesn't fit.
+    void put(const QUrl& url, RUIWebPage* page);
+
+    // Returns the (resumed) page for url, or 0. The caller takes ownership.
+    RUIWebPage* take(const QUrl& url);
+
+    void clear();
+    void dump();
+
+    static qint64 estimatedMemory(RUIWebPage* page);
+
+private:
+    struct Entry {
+        QUrl url;
+        RUIWebPage* page;
+    };
+
+    void suspend(RUIWebPage* page);
+    void resume(RUIWebPage* page);
+    void evict();
+    qint64 totalMemory();
+
+    QList<Entry> m_entries;  // most recently used first
+    int m_hits;
+    int m_misses;
+    int m_evictions;
+};
+
+#endif // RUIPAGEPOOL_H
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruiprefetcher.h"
+#include "browsersettings.h"
+#include "discoveryproxy.h"
+#include "ruinetworkaccessmanager.h"
+#include "tracerecorder.h"
+
+#include <stdio.h>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegExp>
+
+// Here to retry a pump that was held back by the bandwidth cap or the per-host limit.
+static const int PUMP_INTERVAL_MS = 250;
+
+// Only the start of a document is searched for critical subresources.
+static const int DOCUMENT_SCAN_BYTES = 64 * 1024;
+
+// The most the bandwidth cap lets build up while prefetching is idle, in ms at the capped rate.
+static const int RATE_BURST_MS = 1000;
+
+// What a request is assumed to cost until its bytes arrive, so a pump can't start every queued
+// request on one positive token balance. A typical start document or script.
+static const qint64 START_RESERVE_BYTES = 32 * 1024;
+
+RUIPrefetcher* RUIPrefetcher::m_pInstance = NULL;
+
+RUIPrefetcher::RUIPrefetcher()
+    : m_paused(true)
+    , m_homeShown(false)
+    , m_rateTokens(0)
+    , m_reservedBytes(0)
+    , m_bytes(0)
+    , m_documents(0)
+    , m_subresources(0)
+{
+    m_pumpTimer.setInterval(PUMP_INTERVAL_MS);
+    m_pumpTimer.setSingleShot(true);
+    connect(&m_pumpTimer, SIGNAL(timeout()), this, SLOT(pump()));
+
+    connect(DiscoveryProxy::Instance(), SIGNAL(ruiListNotification()), this, SLOT(refresh()));
+}
+
+RUIPrefetcher* RUIPrefetcher::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new RUIPrefetcher;
+    }
+
+    return m_pInstance;
+}
+
+void RUIPrefetcher::setShowingRUI(QObject* window, bool showing)
+{
+    if (showing) {
+        if (!m_windowsShowingRUI.contains(window)) {
+            m_windowsShowingRUI.insert(window);
+            connect(window, SIGNAL(destroyed(QObject*)), this, SLOT(onWindowDestroyed(QObject*)), Qt::UniqueConnection);
+        }
+    } else {
+        m_windowsShowingRUI.remove(window);
+        m_homeShown = true;
+    }
+
+    updatePaused();
+}
+
+// Here when a window closed, maybe while it was showing a RUI.
+void RUIPrefetcher::onWindowDestroyed(QObject* window)
+{
+    m_windowsShowingRUI.remove(window);
+    updatePaused();
+}
+
+// Runs only while no window is showing a RUI.
+void RUIPrefetcher::updatePaused()
+{
+    bool run = m_homeShown && m_windowsShowingRUI.isEmpty();
+
+    if (run && m_paused) {
+        resume();
+    } else if (!run && !m_paused) {
+        pause();
+    }
+}
+
+// Here when no window is showing a RUI any more.
+void RUIPrefetcher::resume()
+{
+    if (!BrowserSettings::Instance()->prefetchEnabled)
+        return;
+
+    m_paused = false;
+    resetRate();
+    refresh();
+}
+
+// Here when a window launched a RUI. Requests in flight are cancelled (and queued again), so the
+// RUI gets all of the bandwidth.
+void RUIPrefetcher::pause()
+{
+    m_paused = true;
+    m_pumpTimer.stop();
+
+    QHash<QNetworkReply*, Job> inFlight = m_inFlight;
+    m_inFlight.clear();
+    m_hostRequests.clear();
+    m_reservedBytes = 0;
+
+    QHashIterator<QNetworkReply*, Job> it(inFlight);
+    while (it.hasNext()) {
+        it.next();
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+
+        Job job = it.value();
+        job.bytes = 0;
+        job.reserved = 0;
+        m_queue.prepend(job);
+    }
+}
+
+void RUIPrefetcher::refresh()
+{
+    if (m_paused)
+        return;
+
+    foreach (const QString& uri, DiscoveryProxy::Instance()->launchURIs()) {
+        enqueue(QUrl(uri), true);
+    }
+
+    pump();
+}
+
+QString RUIPrefetcher::hostKey(const QUrl& url)
+{
+    return url.host() + ":" + QString::number(url.port(url.scheme() == "https" ? 443 : 80));
+}
+
+void RUIPrefetcher::enqueue(const QUrl& url, bool document, bool front)
+{
+    QString scheme = url.scheme();
+    if (!url.isValid() || (scheme != "http" && scheme != "https"))
+        return;
+
+    QString key = url.toString(QUrl::RemoveFragment);
+    if (m_seen.contains(key))
+        return;
+    m_seen.insert(key);
+
+    Job job;
+    job.url = url;
+    job.document = document;
+    job.bytes = 0;
+    job.reserved = 0;
+
+    if (front) {
+        m_queue.prepend(job);
+    } else {
+        m_queue.append(job);
+    }
+}
+
+// The bandwidth cap is a token bucket: it fills at the capped rate, up to RATE_BURST_MS worth,
+// and the bytes received are taken out of it. A burst from one large response just holds back
+// the following requests for a while, and an idle spell doesn't earn more than a short burst.
+bool RUIPrefetcher::withinRate()
+{
+    qint64 rate = qint64(BrowserSettings::Instance()->prefetchMaxKBps) * 1024;
+
+    if (!m_rateClock.isValid())
+        resetRate();
+
+    m_rateTokens = qMin(m_rateTokens + rate * m_rateClock.restart() / 1000, rate * RATE_BURST_MS / 1000);
+    return m_rateTokens > 0;
+}
+
+// Here when prefetching starts again, so the time spent paused doesn't count toward the rate.
+void RUIPrefetcher::resetRate()
+{
+    m_rateTokens = 0;
+    m_rateClock.start();
+}
+
+void RUIPrefetcher::pump()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+
+    if (m_paused || m_queue.isEmpty())
+        return;
+
+    qint64 budget = qint64(settings->prefetchMaxKB) * 1024;
+    if (m_bytes >= budget) {
+        fprintf(stderr, "Prefetch: budget of %d KB used, stopping\n", settings->prefetchMaxKB);
+        m_queue.clear();
+        return;
+    }
+
+    // Every start takes its estimate out of the rate and the budget, so each job is checked
+    // against both. Requests in flight may leave the budget some room when they finish (and
+    // pump again); with none in flight, the last request may go over.
+    bool held = false;
+    for (int i = 0; i < m_queue.count(); ) {
+        bool overBudget = m_reservedBytes > 0 && m_bytes + m_reservedBytes + START_RESERVE_BYTES > budget;
+        if (!withinRate() || overBudget) {
+            held = true;
+            break;
+        }
+
+        if (m_hostRequests.value(hostKey(m_queue[i].url)) >= settings->prefetchPerHost) {
+            held = true;
+            i++;
+            continue;
+        }
+
+        start(m_queue.takeAt(i));
+    }
+
+    if (held && !m_pumpTimer.isActive())
+        m_pumpTimer.start();
+}
+
+// PreferCache: anything the cache already has (fresh or not) costs no network traffic.
+void RUIPrefetcher::start(Job job)
+{
+    TRACE_INSTANT("prefetch", "start");
+
+    job.reserved = START_RESERVE_BYTES;
+    m_rateTokens -= job.reserved;
+    m_reservedBytes += job.reserved;
+
+    QNetworkRequest request(job.url);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+
+    QNetworkReply* reply = RUINetworkAccessManager::Instance()->get(request);
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(finished()), this, SLOT(onFinished()));
+
+    m_inFlight.insert(reply, job);
+    m_hostRequests[hostKey(job.url)]++;
+}
+
+void RUIPrefetcher::onDownloadProgress(qint64 received, qint64)
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    QHash<QNetworkReply*, Job>::iterator it = m_inFlight.find(reply);
+    if (it == m_inFlight.end())
+        return;
+
+    // Cached responses don't use any bandwidth.
+    // Bytes within the start estimate were taken from the rate already.
+    if (!reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+        qint64 bytes = received - it->bytes;
+        qint64 covered = qMin(bytes, it->reserved);
+        it->reserved -= covered;
+        m_reservedBytes -= covered;
+        m_bytes += bytes;
+        m_rateTokens -= bytes - covered;
+        TRACE_COUNTER("prefetch", "bytes", m_bytes);
+    }
+    it->bytes = received;
+}
+
+void RUIPrefetcher::onFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_inFlight.contains(reply))
+        return;
+
+    Job job = m_inFlight.take(reply);
+    QString host = hostKey(job.url);
+
+    // Smaller than estimated (or from the cache): hand back what wasn't used.
+    m_rateTokens += job.reserved;
+    m_reservedBytes -= job.reserved;
+
+    if (--m_hostRequests[host] <= 0)
+        m_hostRequests.remove(host);
+
+    if (reply->error() == QNetworkReply::NoError) {
+        if (job.document) {
+            m_documents++;
+            QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+            if (contentType.isEmpty() || contentType.contains("html"))
+                parseDocument(reply->url(), reply->read(DOCUMENT_SCAN_BYTES));
+        } else {
+            m_subresources++;
+        }
+    } else {
+        // Here to try it again on the next refresh.
+        m_seen.remove(job.url.toString(QUrl::RemoveFragment));
+    }
+
+    reply->deleteLater();
+    pump();
+}
+
+// Queues the scripts and style sheets of the document, ahead of the other RUIs' documents.
+// This is a plain scan rather than a parse; it only needs to find the common cases.
+void RUIPrefetcher::parseDocument(const QUrl& baseUrl, const QByteArray& html)
+{
+    QString text = QString::fromUtf8(html);
+
+    QRegExp script("<script[^>]*\\ssrc\\s*=\\s*[\"']?([^\"'\\s>]+)", Qt::CaseInsensitive);
+    QRegExp link("<link[^>]*>", Qt::CaseInsensitive);
+    QRegExp stylesheet("rel\\s*=\\s*[\"']?stylesheet", Qt::CaseInsensitive);
+    QRegExp href("\\shref\\s*=\\s*[\"']?([^\"'\\s>]+)", Qt::CaseInsensitive);
+
+    QList<QUrl> urls;
+    for (int pos = 0; (pos = script.indexIn(text, pos)) != -1; pos += script.matchedLength()) {
+        urls.append(baseUrl.resolved(QUrl(script.cap(1))));
+    }
+    for (int pos = 0; (pos = link.indexIn(text, pos)) != -1; pos += link.matchedLength()) {
+        QString tag = link.cap(0);
+        if (stylesheet.indexIn(tag) != -1 && href.indexIn(tag) != -1)
+            urls.append(baseUrl.resolved(QUrl(href.cap(1))));
+    }
+
+    // Prepended in reverse, so they are fetched in document order.
+    for (int i = urls.count() - 1; i >= 0; i--) {
+        enqueue(urls[i], false, true);
+    }
+}
+
+void RUIPrefetcher::dump()
+{
+    BrowserSettings* settings = BrowserSettings::Instance();
+
+    fprintf(stderr, "Prefetch: %s\n", !settings->prefetchEnabled ? "disabled" : (m_paused ? "paused" : "running"));
+    fprintf(stderr, "- prefetched: %d documents, %d subresources\n", m_documents, m_subresources);
+    fprintf(stderr, "- from the network: %lld of %d KB\n", m_bytes / 1024, settings->prefetchMaxKB);
+    fprintf(stderr, "- queued: %d, in flight: %d\n", m_queue.count(), m_inFlight.count());
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUIPREFETCHER_H
+#define RUIPREFETCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+
+class QNetworkReply;
+
+// The RUIPrefetcher loads the start document of each discovered RUI, and the scripts and style
+// sheets it references, into the HTTP cache while the navigation page is showing, so that the
+// first launch of a RUI is as fast as a warm one. There is one for all windows, like the
+// catalogue; it is paused while any window is showing a RUI.
+//
+// Prefetching is held to a bandwidth cap (new requests wait while the rate is over it),
+// a number of concurrent requests per host, and a byte budget for the whole session.
+class RUIPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static RUIPrefetcher* Instance();
+
+    // Here when a window shows a RUI, or its navigation screen again.
+    void setShowingRUI(QObject* window, bool showing);
+
+    void dump();
+
+private slots:
+    void onWindowDestroyed(QObject* window);
+    void refresh();
+    void pump();
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onFinished();
+
+private:
+    struct Job {
+        QUrl url;
+        bool document;
+        qint64 bytes;
+        qint64 reserved;  // of the start estimate, not yet used by received bytes
+    };
+
+    RUIPrefetcher();
+    static RUIPrefetcher* m_pInstance;
+
+    void pause();
+    void resume();
+    void updatePaused();
+    void enqueue(const QUrl& url, bool document, bool front = false);
+    void start(Job job);
+    void parseDocument(const QUrl& baseUrl, const QByteArray& html);
+    bool withinRate();
+    void resetRate();
+    static QString hostKey(const QUrl& url);
+
+    bool m_paused;
+    bool m_homeShown;  // stays paused until some window has shown its navigation screen
+    QSet<QObject*> m_windowsShowingRUI;
+    QList<Job> m_queue;
+    QSet<QString> m_seen;
+    QHash<QNetworkReply*, Job> m_inFlight;
+    QHash<QString, int> m_hostRequests;
+    QTimer m_pumpTimer;
+    QElapsedTimer m_rateClock;
+    qint64 m_rateTokens;
+    qint64 m_reservedBytes;
+    qint64 m_bytes;
+    int m_documents;
+    int m_subresources;
+};
+
+#endif // RUIPREFETCHER_H
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ruiprocesshost.h"
+#include "browsersettings.h"
+#include "tracerecorder.h"
+
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QWidget>
+#include <QWindow>
+
+static const int HEARTBEAT_MS = 1000;
+static const int QUIT_TIMEOUT_MS = 1000;
+
+// How long a child has to say hello. Starting a browser process on a loaded set-top box takes
+// much longer than answering a ping, so this isn't the hang timeout.
+static const int SPAWN_TIMEOUT_MS = 30000;
+
+// Restarts allowed within RESTART_WINDOW_MS before we stop trying (a RUI that crashes the
+// child on every load).
+static const int MAX_RESTARTS = 5;
+static const int RESTART_WINDOW_MS = 60000;
+
+// Spawn latencies kept for the statistics.
+static const int MAX_SPAWN_SAMPLES = 32;
+
+// Hosts created so far in this process, so each window's host listens on a name of its own.
+static int s_hostCount = 0;
+
+RUIProcessHost::RUIProcessHost(QWidget* containerParent, QObject *parent)
+    : QObject(parent)
+    , m_containerParent(containerParent)
+    , m_container(0)
+    , m_process(0)
+    , m_socket(0)
+    , m_retiring(0)
+    , m_startPending(false)
+    , m_transportServer(false)
+    , m_loadPending(false)
+    , m_childResident(0)
+    , m_crashes(0)
+    , m_hangs(0)
+    , m_gaveUp(false)
+{
+    m_clock.start();
+
+    connect(&m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    // No server in this process uses the name, so anything listening there is left over from an
+    // earlier process that had our pid.
+    QString name = QString("qtruibrowser-%1-%2").arg(QCoreApplication::applicationPid()).arg(++s_hostCount);
+    QLocalServer::removeServer(name);
+    if (!m_server.listen(name))
+        fprintf(stderr, "RUI process host: unable to listen on %s\n", name.toUtf8().data());
+
+    m_heartbeatTimer.setInterval(HEARTBEAT_MS);
+    connect(&m_heartbeatTimer, SIGNAL(timeout()), this, SLOT(onHeartbeat()));
+}
+
+// There's no event loop left to wait on here, so give the child a moment to quit before
+// QProcess kills it.
+RUIProcessHost::~RUIProcessHost()
+{
+    stop();
+    if (m_retiring)
+        m_retiring->waitForFinished(QUIT_TIMEOUT_MS);
+}
+
+void RUIProcessHost::start()
+{
+    if (m_process || m_gaveUp)
+        return;
+
+    TRACE_SCOPE("process", "spawn");
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::ForwardedChannels);
+    connect(m_process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onProcessFinished(int, QProcess::ExitStatus)));
+    connect(m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onProcessError(QProcess::ProcessError)));
+
+    // The hang clock starts with hello; until then the child has SPAWN_TIMEOUT_MS.
+    m_spawnClock.start();
+    m_pongClock.invalidate();
+    m_heartbeatTimer.start();
+    m_process->start(QCoreApplication::applicationFilePath(), QStringList() << "--rui-child" << m_server.fullServerName());
+}
+
+void RUIProcessHost::load(const QUrl& url, bool transportServer)
+{
+    m_url = url;
+    m_transportServer = transportServer;
+    m_loadPending = true;
+
+    if (m_gaveUp) {
+        // Asked for again by the user, so give it another go.
+        m_gaveUp = false;
+        m_restartTimes.clear();
+    }
+
+    if (m_socket) {
+        sendLoad();
+    } else {
+        start();
+    }
+}
+
+// Here when the navigation page is back. The child stays up for the next RUI, but lets go of
+// this one.
+void RUIProcessHost::unload()
+{
+    m_url = QUrl();
+    m_loadPending = false;
+    send("load", "0 about:blank");
+}
+
+void RUIProcessHost::sendLoad()
+{
+    m_loadPending = false;
+    send("load", QString("%1 %2").arg(m_transportServer ? 1 : 0).arg(m_url.toString()));
+}
+
+void RUIProcessHost::onNewConnection()
+{
+    QLocalSocket* socket = m_server.nextPendingConnection();
+
+    // Only the child we started; anything else (a child we've given up on) is turned away.
+    if (m_socket || !m_process) {
+        socket->deleteLater();
+        return;
+    }
+
+    m_socket = socket;
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+void RUIProcessHost::send(const char* message, const QString& argument)
+{
+    if (!m_socket)
+        return;
+
+    QByteArray line(message);
+    if (!argument.isEmpty())
+        line += ' ' + argument.toUtf8();
+    line += '\n';
+
+    m_socket->write(line);
+    m_socket->flush();
+}
+
+void RUIProcessHost::onReadyRead()
+{
+    while (m_socket && m_socket->canReadLine()) {
+        QByteArray line = m_socket->readLine().trimmed();
+        int space = line.indexOf(' ');
+        QByteArray message = (space < 0) ? line : line.left(space);
+        QString argument = (space < 0) ? QString() : QString::fromUtf8(line.mid(space + 1));
+        handleMessage(message, argument);
+    }
+}
+
+void RUIProcessHost::handleMessage(const QByteArray& message, const QString& argument)
+{
+    if (message == "hello") {
+        // The child is up: embed its window, and hand it the RUI if one is waiting.
+        qint64 latency = m_spawnClock.elapsed();
+        m_spawnLatencies.append(latency);
+        if (m_spawnLatencies.count() > MAX_SPAWN_SAMPLES)
+            m_spawnLatencies.removeFirst();
+        fprintf(stderr, "RUI child %lld ready in %lld ms\n", qint64(m_process->processId()), latency);
+
+        QWindow* window = QWindow::fromWinId(WId(argument.toULongLong()));
+        m_container = QWidget::createWindowContainer(window, m_containerParent);
+        m_container->setFocusPolicy(Qt::StrongFocus);
+        emit containerChanged(m_container);
+
+        m_pongClock.start();
+
+        if (m_loadPending)
+            sendLoad();
+    } else if (message == "pong") {
+        m_childResident = argument.toLongLong();
+        m_pongClock.start();
+    } else if (message == "title") {
+        emit titleChanged(argument);
+    } else if (message == "url") {
+        emit urlChanged(QUrl(argument));
+    } else if (message == "home") {
+        emit homeRequested();
+    } else if (message == "loaded") {
+        TRACE_INSTANT("process", "child load finished");
+    }
+}
+
+void RUIProcessHost::onHeartbeat()
+{
+    if (!m_pongClock.isValid()) {
+        if (m_spawnClock.elapsed() > SPAWN_TIMEOUT_MS) {
+            m_hangs++;
+            restart("no hello");
+        }
+        return;
+    }
+
+    int hangMs = BrowserSettings::Instance()->childHangSeconds * 1000;
+    if (hangMs > 0 && m_pongClock.elapsed() > hangMs) {
+        m_hangs++;
+        restart("not responding");
+        return;
+    }
+
+    send("ping");
+}
+
+// Here when the child exited without being asked to (we disconnect first when we stop it).
+void RUIProcessHost::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    fprintf(stderr, "RUI child exited (%s, code %d)\n",
+            exitStatus == QProcess::CrashExit ? "crashed" : "normal exit", exitCode);
+
+    m_crashes++;
+    restart("exited");
+}
+
+void RUIProcessHost::onProcessError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart)
+        return;
+
+    fprintf(stderr, "Unable to start RUI child: %s\n", m_process->errorString().toUtf8().data());
+    stop();
+    m_gaveUp = true;
+    emit homeRequested();
+}
+
+// Here to replace the child: tear down what's left of it and spawn a new one, which reloads the
+// RUI it was showing. A hung child is killed, and the new one started once it has gone.
+void RUIProcessHost::restart(const char* reason)
+{
+    TRACE_INSTANT("process", "restart");
+    fprintf(stderr, "Restarting RUI child: %s\n", reason);
+
+    bool hadRUI = m_url.isValid();
+    stop(true);
+
+    qint64 now = m_clock.elapsed();
+    m_restartTimes.append(now);
+    while (!m_restartTimes.isEmpty() && now - m_restartTimes.first() > RESTART_WINDOW_MS)
+        m_restartTimes.removeFirst();
+
+    if (m_restartTimes.count() > MAX_RESTARTS) {
+        fprintf(stderr, "RUI child restarted %d times in %d s, giving up on %s\n",
+                m_restartTimes.count(), RESTART_WINDOW_MS / 1000, m_url.toString().toUtf8().data());
+        m_gaveUp = true;
+        m_loadPending = false;
+        emit homeRequested();
+        return;
+    }
+
+    m_loadPending = hadRUI;
+    if (m_retiring) {
+        m_startPending = true;
+    } else {
+        start();
+    }
+}
+
+// Here to let go of the child without waiting for it (this is the GUI thread). It is asked to
+// quit, and killed if it hasn't within QUIT_TIMEOUT_MS, or right away if kill is set. It is
+// deleted once it has exited.
+void RUIProcessHost::stop(bool kill)
+{
+    m_heartbeatTimer.stop();
+
+    if (m_container) {
+        QWidget* container = m_container;
+        m_container = 0;
+        container->hide();
+        container->deleteLater();
+        emit containerChanged(0);
+    }
+
+    if (m_process) {
+        QProcess* process = m_process;
+        m_process = 0;
+        disconnect(process, 0, this, 0);
+
+        if (process->state() == QProcess::NotRunning) {
+            process->deleteLater();
+        } else {
+            m_retiring = process;
+            connect(process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onRetiredProcessFinished()));
+            if (kill || !m_socket) {
+                process->kill();
+            } else {
+                send("quit");
+                QTimer::singleShot(QUIT_TIMEOUT_MS, process, SLOT(kill()));
+            }
+        }
+    }
+
+    if (m_socket) {
+        m_socket->deleteLater();
+        m_socket = 0;
+    }
+}
+
+void RUIProcessHost::onRetiredProcessFinished()
+{
+    QProcess* process = qobject_cast<QProcess*>(sender());
+    process->deleteLater();
+
+    if (process != m_retiring)
+        return;
+    m_retiring = 0;
+
+    if (m_startPending) {
+        m_startPending = false;
+        start();
+    }
+}
+
+void RUIProcessHost::dump()
+{
+    fprintf(stderr, "\nRUI child process:\n");
+
+    if (m_process) {
+        fprintf(stderr, "  pid %lld, %s, resident %lld KB\n", qint64(m_process->processId()),
+                m_socket ? "connected" : "starting", m_childResident / 1024);
+    } else {
+        fprintf(stderr, "  none%s\n", m_gaveUp ? " (stopped after repeated failures)" : "");
+    }
+
+    fprintf(stderr, "  showing: %s\n", m_url.isValid() ? m_url.toString().toUtf8().data() : "-");
+
+    if (!m_spawnLatencies.isEmpty()) {
+        qint64 total = 0;
+        foreach (qint64 latency, m_spawnLatencies)
+            total += latency;
+        fprintf(stderr, "  spawn to window ready: last %lld ms, mean %lld ms (%d spawns)\n",
+                m_spawnLatencies.last(), total / m_spawnLatencies.count(), m_spawnLatencies.count());
+    }
+
+    fprintf(stderr, "  restarts: %d after exit or crash, %d after hang\n", m_crashes, m_hangs);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RUIPROCESSHOST_H
+#define RUIPROCESSHOST_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+#include <QUrl>
+
+class QWidget;
+
+// Process-per-RUI (performance/processPerRUI). RUIs are shown by a child process (the browser
+// started with --rui-child), so a crashing or runaway RUI can't take the navigation page and
+// discovery with it. The child's window is embedded in ours (QWindow::fromWinId()). A child
+// that crashes, or doesn't answer a ping for performance/childHangSeconds, is restarted and
+// reloads its RUI. Spawn latency (start to window ready) and the child's resident size are kept
+// for dump().
+//
+// Protocol: one message per line over a local socket, "<message> [argument]".
+//   child:  hello <window id>, pong <resident bytes>, loaded <0|1>, title <title>, url <url>, home
+//   parent: load <0|1 transport server> <url>, ping, quit
+class RUIProcessHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    RUIProcessHost(QWidget* containerParent, QObject *parent = 0);
+    ~RUIProcessHost();
+
+    void load(const QUrl& url, bool transportServer);
+    void unload();
+    QWidget* container() const { return m_container; }
+
+    void dump();
+
+public slots:
+    // Spawn a child ahead of the first load, so its startup is off the critical path.
+    void start();
+
+signals:
+    // The child's window, embedded, or 0 while there is no child.
+    void containerChanged(QWidget* container);
+    void homeRequested();
+    void titleChanged(const QString& title);
+    void urlChanged(const QUrl& url);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+    void onHeartbeat();
+    void onRetiredProcessFinished();
+
+private:
+    void send(const char* message, const QString& argument = QString());
+    void handleMessage(const QByteArray& message, const QString& argument);
+    void sendLoad();
+    void restart(const char* reason);
+    void stop(bool kill = false);
+
+    QWidget* m_containerParent;
+    QWidget* m_container;
+    QLocalServer m_server;
+    QProcess* m_process;
+    QLocalSocket* m_socket;
+
+    // A child that was stopped but hasn't exited yet. A restart waits for it.
+    QProcess* m_retiring;
+    bool m_startPending;
+
+    QUrl m_url;
+    bool m_transportServer;
+    bool m_loadPending;
+
+    QTimer m_heartbeatTimer;
+    QElapsedTimer m_pongClock;
+    QElapsedTimer m_spawnClock;
+    QElapsedTimer m_clock;
+    QList<qint64> m_spawnLatencies;
+    QList<qint64> m_restartTimes;
+    qint64 m_childResident;
+    int m_crashes;
+    int m_hangs;
+    bool m_gaveUp;
+};
+
+#endif // RUIPROCESSHOST_H
@@ -27,19 +27,37 @@
 #include "qwebpage.h"
 #include "discoveryproxy.h"
 #include "browsersettings.h"
+#include "ruinetworkaccessmanager.h"
+#include "hostlatency.h"
 
 #include <QMessageBox>
 #include <QNetworkReply>
 #include <QSslError>
 #include <QtDebug>
 
-static const int TIMEOUT_SECONDS = 10;
+// Collects the numeric attributes of window.performance.timing (they live on the prototype, so
+// JSON.stringify() would return an empty object).
+static const char* performanceTimingScript =
+    "(function() {"
+    "    var timing = window.performance && window.performance.timing;"
+    "    var result = {};"
+    "    for (var name in timing) {"
+    "        if (typeof timing[name] == 'number') result[name] = timing[name];"
+    "    }"
+    "    return result;"
+    "})()";
+
+// Property used to hand each reply's byte count from downloadProgress() to finished().
+static const char* bytesReceivedProperty = "ruiBytesReceived";
 
 RUIWebPage::RUIWebPage(QObject* parent)
     : QWebPage(parent)
+    , m_loading(false)
 {
-    m_loadTimer.setInterval(TIMEOUT_SECONDS * 1000);
+    setNetworkAccessManager(RUINetworkAccessManager::Instance());
+
     m_loadTimer.setSingleShot(true);
+    m_firstByteTimer.setSingleShot(true);
 
     connect(this, SIGNAL(loadFinished(bool)), this, SLOT(handleLoadFinished(bool)));
     connect(this, SIGNAL(loadStarted()), this, SLOT(handleLoadStarted()));
@@ -47,6 +65,17 @@ RUIWebPage::RUIWebPage(QObject* parent)
         SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)), this,
         SLOT(handleSslErrors(QNetworkReply*, const QList<QSslError> &)));
     connect(&m_loadTimer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+    connect(&m_firstByteTimer, SIGNAL(timeout()), this, SLOT(handleFirstByteTimeout()));
+    connect(networkAccessManager(), SIGNAL(replyCreated(QNetworkReply*)), this, SLOT(handleReplyCreated(QNetworkReply*)));
+    connect(mainFrame(), SIGNAL(initialLayoutCompleted()), this, SLOT(handleInitialLayoutCompleted()));
+}
+
+// The network access manager is shared by all pages; QtWebKit sets the requesting frame as the
+// originating object of each request, so that tells whose reply this is.
+bool RUIWebPage::isOwnReply(QNetworkReply* reply)
+{
+    QWebFrame* frame = qobject_cast<QWebFrame*>(reply->request().originatingObject());
+    return frame && frame->page() == this;
 }
 
 QString RUIWebPage::userAgentForUrl(const QUrl& url) const
@@ -56,14 +85,13 @@ QString RUIWebPage::userAgentForUrl(const QUrl& url) const
     QString scheme = url.scheme();
     QString host = url.host();
 
-    DiscoveryProxy* proxy = DiscoveryProxy::Instance();
     BrowserSettings* settings = BrowserSettings::Instance();
 
     // Always add the product token, but only add the CertID if this is a RUI Transport Server
     // AND the protocol is https.
     userAgent += " DLNADOC/1.50 DLNA-HTML5/1.0";
     if (scheme.compare("https") == 0) {
-        if (proxy->isHostRUITransportServer(host)) {
+        if (isHostRUITransportServer(host)) {
             userAgent += " (CertID " + settings->certID + ")";
         }
     }
@@ -71,20 +99,113 @@ QString RUIWebPage::userAgentForUrl(const QUrl& url) const
     return userAgent;
 }
 
+bool RUIWebPage::isHostRUITransportServer(const QString& host) const
+{
+    return DiscoveryProxy::Instance()->isHostRUITransportServer(host);
+}
+
 void RUIWebPage::handleLoadFinished(bool ok)
 {
     qDebug() << "Load" << (ok ? "successful" : "failed");
     m_loadTimer.stop();
+    m_firstByteTimer.stop();
+
+    if (!m_loading)
+        return;
+    m_loading = false;
+
+    m_timeline.ok = ok;
+    m_timeline.loadFinished = m_loadClock.elapsed();
+    if (ok && !m_loadHost.isEmpty())
+        HostLatency::Instance()->record(m_loadHost, m_timeline.loadFinished, m_timeline.firstByte);
+    if (m_timeline.uri.isEmpty())
+        m_timeline.uri = mainFrame()->url().toString();
+
+    // DOMContentLoaded has no signal in QtWebKit; take it from the page's navigation timing.
+    QVariantMap timing = mainFrame()->evaluateJavaScript(performanceTimingScript).toMap();
+    m_timeline.performanceTiming = timing;
+    qint64 navigationStart = timing.value("navigationStart").toLongLong();
+    qint64 domContentLoaded = timing.value("domContentLoadedEventStart").toLongLong();
+    if (navigationStart > 0 && domContentLoaded >= navigationStart)
+        m_timeline.domContentLoaded = domContentLoaded - navigationStart;
+
+    PageLoadTimings::Instance()->record(m_timeline);
 }
 
 void RUIWebPage::handleLoadStarted()
 {
-    qDebug() << "Started page load. Setting timeout for " << TIMEOUT_SECONDS << " seconds.";
-    m_loadTimer.start();
+    QUrl url = mainFrame()->requestedUrl();
+    HostLatency* latency = HostLatency::Instance();
+    m_loadHost = url.host();
+
+    int timeout = latency->loadTimeout(m_loadHost);
+    qDebug() << "Started page load. Setting timeout for " << timeout << " ms.";
+    m_loadTimer.start(timeout);
+
+    // Only network loads are expected to produce a response; local ones may not go through
+    // the network access manager at all.
+    if (url.scheme() == "http" || url.scheme() == "https")
+        m_firstByteTimer.start(latency->firstByteTimeout(m_loadHost));
+    else
+        m_firstByteTimer.stop();
+
+    m_loading = true;
+    m_loadClock.start();
+    m_timeline = PageLoadTimeline();
+    m_timeline.uri = url.toString();
+    m_timeline.started = QDateTime::currentDateTime();
+    m_timeline.visible = (view() != 0);
+}
+
+void RUIWebPage::handleInitialLayoutCompleted()
+{
+    if (m_loading && m_timeline.firstLayout < 0)
+        m_timeline.firstLayout = m_loadClock.elapsed();
+}
+
+void RUIWebPage::handleReplyCreated(QNetworkReply* reply)
+{
+    if (!m_loading || !isOwnReply(reply))
+        return;
+
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(handleReplyMetaDataChanged()));
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(handleReplyDownloadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(finished()), this, SLOT(handleReplyFinished()));
+}
+
+// The document is the first request of a load, so the first response is its first byte.
+void RUIWebPage::handleReplyMetaDataChanged()
+{
+    m_firstByteTimer.stop();
+
+    if (m_loading && m_timeline.firstByte < 0)
+        m_timeline.firstByte = m_loadClock.elapsed();
+}
+
+void RUIWebPage::handleReplyDownloadProgress(qint64 received, qint64)
+{
+    sender()->setProperty(bytesReceivedProperty, received);
+}
+
+void RUIWebPage::handleReplyFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_loading)
+        return;
+
+    m_timeline.resources++;
+    m_timeline.bytes += reply->property(bytesReceivedProperty).toLongLong();
 }
 
 void RUIWebPage::handleSslErrors(QNetworkReply* reply, const QList<QSslError> &errors)
 {
+    if (!isOwnReply(reply))
+        return;
+
+    // Not on screen (prerendering); don't ask, just let the load fail.
+    if (!view())
+        return;
+
     QStringList errorMessages;
     foreach (QSslError e, errors) {
         errorMessages += e.errorString();
@@ -104,6 +225,32 @@ void RUIWebPage::handleSslErrors(QNetworkReply* reply, const QList<QSslError> &e
 void RUIWebPage::handleTimeout()
 {
     qDebug() << "Timeout reached, cancelling page load.";
+
+    // The load was at least this slow; let the host's timeout grow if that keeps happening.
+    if (m_loading && !m_loadHost.isEmpty())
+        HostLatency::Instance()->record(m_loadHost, m_loadClock.elapsed(), m_timeline.firstByte);
+
     triggerAction(Stop, false);
+
+    if (!view())
+        return;
+
     QMessageBox::warning(view(), "Page Load Timeout", "Page took too long to load.");
 }
+
+// Here when the server hasn't started responding: most likely it's gone.
+void RUIWebPage::handleFirstByteTimeout()
+{
+    qDebug() << "No response from" << m_loadHost << ", cancelling page load.";
+
+    if (m_loading && !m_loadHost.isEmpty())
+        HostLatency::Instance()->recordFirstByteTimeout(m_loadHost);
+
+    m_loadTimer.stop();
+    triggerAction(Stop, false);
+
+    if (!view())
+        return;
+
+    QMessageBox::warning(view(), "Page Load Timeout", "The server is not responding.");
+}
@@ -26,10 +26,15 @@
 #ifndef ruiwebpage_h
 #define ruiwebpage_h
 
+#include <qelapsedtimer.h>
 #include <qtimer.h>
 #include <qwebframe.h>
 #include <qwebpage.h>
 
+#include "pageloadtimings.h"
+
+class QNetworkReply;
+
 class RUIWebPage : public QWebPage {
     Q_OBJECT
 
@@ -38,14 +43,33 @@ public:
 
     QString userAgentForUrl(const QUrl& url) const;
 
+protected:
+    // Whether host is a RUI transport server, for the CertID in the user agent.
+    virtual bool isHostRUITransportServer(const QString& host) const;
+
 private slots:
     void handleLoadFinished(bool ok);
     void handleLoadStarted();
     void handleSslErrors(QNetworkReply* reply, const QList<QSslError> &errors);
     void handleTimeout();
+    void handleFirstByteTimeout();
+    void handleInitialLayoutCompleted();
+    void handleReplyCreated(QNetworkReply* reply);
+    void handleReplyMetaDataChanged();
+    void handleReplyDownloadProgress(qint64 received, qint64 total);
+    void handleReplyFinished();
 
 private:
+    bool isOwnReply(QNetworkReply* reply);
+
     QTimer m_loadTimer;
+    QTimer m_firstByteTimer;
+    QString m_loadHost;
+
+    // Timeline of the load in progress, recorded with PageLoadTimings when it finishes.
+    bool m_loading;
+    QElapsedTimer m_loadClock;
+    PageLoadTimeline m_timeline;
 };
 
 #endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "startuptrace.h"
+#include "tracerecorder.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <QFile>
+#include <QList>
+
+QElapsedTimer StartupTrace::m_clock;
+bool StartupTrace::m_enabled = false;
+
+// Here first thing in main().
+void StartupTrace::start()
+{
+    m_clock.start();
+}
+
+void StartupTrace::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+
+    if (enabled) {
+        qint64 age = processAge();
+        if (age >= 0)
+            fprintf(stderr, "Startup: process started %lld ms before main()\n", age - m_clock.elapsed());
+    }
+}
+
+qint64 StartupTrace::elapsed()
+{
+    return m_clock.elapsed();
+}
+
+void StartupTrace::mark(const char* phase)
+{
+    TRACE_INSTANT("startup", phase);
+
+    if (m_enabled)
+        fprintf(stderr, "Startup: %6lld ms  %s\n", m_clock.elapsed(), phase);
+}
+
+// Time since the process was started (exec, dynamic linking and static initialization
+// included), in ms, from /proc. -1 where that isn't available.
+qint64 StartupTrace::processAge()
+{
+    QFile stat("/proc/self/stat");
+    QFile uptime("/proc/uptime");
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly))
+        return -1;
+
+    // The second field (comm) may contain spaces; the fields we want follow the last ')'.
+    QByteArray statLine = stat.readAll();
+    QList<QByteArray> fields = statLine.mid(statLine.lastIndexOf(')') + 2).split(' ');
+    if (fields.count() < 20)
+        return -1;
+
+    qint64 startTicks = fields[19].toLongLong();  // field 22, starttime
+    double uptimeSeconds = uptime.readAll().split(' ').first().toDouble();
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (ticksPerSecond <= 0)
+        return -1;
+
+    return qint64(uptimeSeconds * 1000) - startTicks * 1000 / ticksPerSecond;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel(int slotCount)
+    : m_slots(slotCount > 0 ? slotCount : 1)
+    , m_currentTick(0)
+{
+}
+
+void TimerWheel::schedule(const QString& key, int ticks)
+{
+    if (ticks < 1)
+        ticks = 1;
+
+    quint64 deadline = m_currentTick + ticks;
+    QHash<QString, quint64>::iterator i = m_deadlines.find(key);
+    if (i != m_deadlines.end() && i.value() == deadline)
+        return;
+
+    m_deadlines.insert(key, deadline);
+    m_slots[deadline % m_slots.size()].append(key);
+}
+
+void TimerWheel::cancel(const QString& key)
+{
+    m_deadlines.remove(key);
+}
+
+bool TimerWheel::contains(const QString& key) const
+{
+    return m_deadlines.contains(key);
+}
+
+int TimerWheel::count() const
+{
+    return m_deadlines.count();
+}
+
+QStringList TimerWheel::advance()
+{
+    m_currentTick++;
+
+    int index = m_currentTick % m_slots.size();
+    QStringList entries;
+    entries.swap(m_slots[index]);
+
+    QStringList expired;
+    foreach (const QString& key, entries) {
+        QHash<QString, quint64>::iterator i = m_deadlines.find(key);
+        if (i == m_deadlines.end()) {
+            // Cancelled, or already expired through a duplicate entry.
+            continue;
+        }
+
+        quint64 deadline = i.value();
+        if (deadline == m_currentTick) {
+            m_deadlines.erase(i);
+            expired.append(key);
+        } else if (deadline > m_currentTick && int(deadline % m_slots.size()) == index) {
+            // Due on a later revolution of the wheel.
+            if (!m_slots[index].contains(key))
+                m_slots[index].append(key);
+        }
+        // Otherwise the key was rescheduled into another slot; drop this entry.
+    }
+
+    return expired;
+}
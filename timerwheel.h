@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A hashed timer wheel. Keys are scheduled a number of ticks in the future; advance() moves
+// the wheel one tick and returns the keys that expired on it. Scheduling, rescheduling and
+// cancelling are O(1), and a tick only visits the keys hashed to its slot, so expiring a large
+// number of entries does not require scanning all of them.
+//
+// Rescheduling leaves the old slot entry in place. It is recognized as stale (its deadline no
+// longer matches) and dropped when its slot comes around.
+class TimerWheel
+{
+public:
+    explicit TimerWheel(int slotCount = 512);
+
+    void schedule(const QString& key, int ticks);
+    void cancel(const QString& key);
+    bool contains(const QString& key) const;
+    int count() const;
+
+    QStringList advance();
+
+private:
+    QVector<QStringList> m_slots;
+    QHash<QString, quint64> m_deadlines;
+    quint64 m_currentTick;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "tracerecorder.h"
+
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+
+// Here to bound the memory used by a trace left running; later events are dropped.
+static const int MAX_EVENTS = 1000000;
+
+TraceRecorder* TraceRecorder::m_pInstance = NULL;
+QAtomicInt TraceRecorder::m_enabled;
+
+TraceRecorder::TraceRecorder()
+{
+    m_clock.start();
+}
+
+// Created (on the main thread) by the first setEnabled(), before any other thread can see
+// isEnabled() return true.
+TraceRecorder* TraceRecorder::Instance()
+{
+    if (!m_pInstance) {
+        m_pInstance = new TraceRecorder;
+    }
+
+    return m_pInstance;
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    m_enabled.storeRelease(enabled ? 1 : 0);
+
+    QMutexLocker locker(&m_mutex);
+    fprintf(stderr, "Tracing %s (%d events)\n", enabled ? "started" : "stopped", m_events.count());
+}
+
+void TraceRecorder::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+}
+
+void TraceRecorder::add(char phase, const char* category, const char* name, qint64 value)
+{
+    qint64 timestamp = m_clock.nsecsElapsed() / 1000;
+    Qt::HANDLE threadId = QThread::currentThreadId();
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_events.count() >= MAX_EVENTS)
+        return;
+
+    QHash<Qt::HANDLE, int>::const_iterator it = m_threads.constFind(threadId);
+    int thread = (it != m_threads.constEnd()) ? it.value() : m_threads.insert(threadId, m_threads.count() + 1).value();
+
+    Event event;
+    event.phase = phase;
+    event.category = category;
+    event.name = name;
+    event.timestamp = timestamp;
+    event.thread = thread;
+    event.value = value;
+    m_events.append(event);
+}
+
+static QByteArray jsonString(const char* str)
+{
+    QByteArray escaped;
+    for (const char* p = str; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            escaped += '\\';
+        escaped += *p;
+    }
+    return '"' + escaped + '"';
+}
+
+// Written by hand rather than through QJsonDocument; traces get large.
+QByteArray TraceRecorder::toJson()
+{
+    QMutexLocker locker(&m_mutex);
+
+    QByteArray json;
+    json.reserve(m_events.count() * 100);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    qint64 pid = QCoreApplication::applicationPid();
+    for (int i = 0; i < m_events.count(); i++) {
+        const Event& event = m_events[i];
+        json += "{\"ph\":\"";
+        json += event.phase;
+        json += "\",\"cat\":" + jsonString(event.category);
+        json += ",\"name\":" + jsonString(event.name);
+        json += ",\"ts\":" + QByteArray::number(event.timestamp);
+        json += ",\"pid\":" + QByteArray::number(pid);
+        json += ",\"tid\":" + QByteArray::number(event.thread);
+        if (event.phase == 'C')
+            json += ",\"args\":{" + jsonString(event.name) + ":" + QByteArray::number(event.value) + "}";
+        else if (event.phase == 'i')
+            json += ",\"s\":\"t\"";
+        else if (event.phase == 'b' || event.phase == 'e')
+            json += ",\"id\":\"0x" + QByteArray::number(event.value, 16) + "\"";
+        json += (i + 1 < m_events.count()) ? "},\n" : "}\n";
+    }
+
+    json += "]}\n";
+    return json;
+}
+
+bool TraceRecorder::save(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "Unable to write %s\n", fileName.toUtf8().data());
+        return false;
+    }
+
+    file.write(toJson());
+
+    QMutexLocker locker(&m_mutex);
+    fprintf(stderr, "Wrote %d trace events to %s\n", m_events.count(), fileName.toUtf8().data());
+    return true;
+}
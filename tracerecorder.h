@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012, 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+// The TraceRecorder collects begin/end, async, instant and counter events from any thread and writes
+// them in the Chrome trace event format, which about:tracing and Perfetto (ui.perfetto.dev)
+// can open. Categories and names must be string literals; only the pointers are stored.
+//
+// Use the TRACE_* macros rather than the class. They cost one atomic load while recording is
+// off, and compile to nothing when QTRUIBROWSER_NO_TRACING is defined.
+class TraceRecorder
+{
+public:
+    static TraceRecorder* Instance();
+
+    static bool isEnabled() { return m_enabled.loadAcquire() != 0; }
+    void setEnabled(bool enabled);
+    void clear();
+
+    void add(char phase, const char* category, const char* name, qint64 value = 0);
+
+    QByteArray toJson();
+    bool save(const QString& fileName);
+
+private:
+    TraceRecorder();
+    static TraceRecorder* m_pInstance;
+    static QAtomicInt m_enabled;
+
+    struct Event {
+        char phase;
+        const char* category;
+        const char* name;
+        qint64 timestamp;  // microseconds
+        int thread;
+        qint64 value;  // counter value, or async event id
+    };
+
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QVector<Event> m_events;
+    QHash<Qt::HANDLE, int> m_threads;
+};
+
+// Ends the event begun by TRACE_SCOPE when it goes out of scope.
+class TraceScope
+{
+public:
+    TraceScope(const char* category, const char* name)
+        : m_category(category)
+        , m_name(name)
+        , m_active(TraceRecorder::isEnabled())
+    {
+        if (m_active)
+            TraceRecorder::Instance()->add('B', m_category, m_name);
+    }
+
+    ~TraceScope()
+    {
+        if (m_active)
+            TraceRecorder::Instance()->add('E', m_category, m_name);
+    }
+
+private:
+    const char* m_category;
+    const char* m_name;
+    bool m_active;
+};
+
+#ifdef QTRUIBROWSER_NO_TRACING
+
+#define TRACE_SCOPE(category, name)
+#define TRACE_BEGIN(category, name) do { } while (0)
+#define TRACE_END(category, name) do { } while (0)
+#define TRACE_INSTANT(category, name) do { } while (0)
+#define TRACE_COUNTER(category, name, value) do { } while (0)
+#define TRACE_ASYNC_BEGIN(category, name, id) do { } while (0)
+#define TRACE_ASYNC_END(category, name, id) do { } while (0)
+
+#else
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_EVENT_(phase, category, name, value) \
+    do { if (TraceRecorder::isEnabled()) TraceRecorder::Instance()->add(phase, category, name, value); } while (0)
+
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_BEGIN(category, name) TRACE_EVENT_('B', category, name, 0)
+#define TRACE_END(category, name) TRACE_EVENT_('E', category, name, 0)
+#define TRACE_INSTANT(category, name) TRACE_EVENT_('i', category, name, 0)
+#define TRACE_COUNTER(category, name, value) TRACE_EVENT_('C', category, name, value)
+
+// For spans that start and end in different calls (a network request and its reply); the id
+// (typically the reply's address) pairs the begin with its end.
+#define TRACE_ASYNC_BEGIN(category, name, id) TRACE_EVENT_('b', category, name, qint64(quintptr(id)))
+#define TRACE_ASYNC_END(category, name, id) TRACE_EVENT_('e', category, name, qint64(quintptr(id)))
+
+#endif // QTRUIBROWSER_NO_TRACING
+
+#endif // TRACERECORDER_H
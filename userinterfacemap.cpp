@@ -24,20 +24,123 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include "userinterfacemap.h"
+#include "tracerecorder.h"
+#include "iconcache.h"
+#include "iconatlas.h"
 #include <QMap>
+#include <QSet>
 #include <QUrl>
+#include <QJsonDocument>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
 #include <stdio.h>
 
+// Snapshot file header. Bump the version whenever the stream layout below changes; snapshots
+// with a different version are ignored.
+static const quint32 SNAPSHOT_MAGIC = 0x52554943; // "RUIC"
+static const quint32 SNAPSHOT_VERSION = 1;
+
+// Expiry resolution. One wheel revolution covers 512 seconds; longer max-ages simply take
+// several revolutions.
+static const int EXPIRY_TICK_MS = 1000;
+static const int EXPIRY_WHEEL_SLOTS = 512;
+
+static void writeUI(QDataStream& out, const RUIInterface& ui)
+{
+    out << ui.m_uiID << ui.m_name << ui.m_description;
+
+    out << qint32(ui.m_iconList.count());
+    foreach (const RUIIcon& icon, ui.m_iconList)
+        out << icon.m_mimeType << icon.m_width << icon.m_height << icon.m_depth << icon.m_url;
+
+    out << qint32(ui.m_protocolList.count());
+    foreach (const RUIProtocol& protocol, ui.m_protocolList)
+        out << protocol.m_shortName << protocol.m_protocolInfo << protocol.m_uriList;
+}
+
+static RUIInterface readUI(QDataStream& in)
+{
+    RUIInterface ui;
+    qint32 count;
+
+    in >> ui.m_uiID >> ui.m_name >> ui.m_description;
+
+    in >> count;
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        RUIIcon icon;
+        in >> icon.m_mimeType >> icon.m_width >> icon.m_height >> icon.m_depth >> icon.m_url;
+        ui.m_iconList.append(icon);
+    }
+
+    in >> count;
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        RUIProtocol protocol;
+        in >> protocol.m_shortName >> protocol.m_protocolInfo >> protocol.m_uriList;
+        ui.m_protocolList.append(protocol);
+    }
+
+    return ui;
+}
+
+static void writeDevice(QDataStream& out, const RUIDevice& device)
+{
+    out << device.m_friendlyName << device.m_baseURL << device.m_uuid << device.m_rootDeviceUuid << device.m_descriptionURL;
+
+    out << qint32(device.m_serviceList.count());
+    foreach (const RUIService& service, device.m_serviceList) {
+        out << service.m_serviceID << service.m_serviceType << service.m_baseURL
+            << service.m_eventURL << service.m_controlURL << service.m_descriptionURL;
+    }
+}
+
+static RUIDevice readDevice(QDataStream& in)
+{
+    RUIDevice device;
+    qint32 count;
+
+    in >> device.m_friendlyName >> device.m_baseURL >> device.m_uuid >> device.m_rootDeviceUuid >> device.m_descriptionURL;
+
+    in >> count;
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        RUIService service;
+        in >> service.m_serviceID >> service.m_serviceType >> service.m_baseURL
+           >> service.m_eventURL >> service.m_controlURL >> service.m_descriptionURL;
+        device.m_serviceList.append(service);
+    }
+
+    return device;
+}
+
 
 UserInterfaceMap::UserInterfaceMap(QObject *parent) :
     QObject(parent)
+    , m_uiListJsonValid(false)
+    , m_revision(0)
+    , m_expiryWheel(EXPIRY_WHEEL_SLOTS)
 {
+    connect(&m_expiryTimer, SIGNAL(timeout()), this, SLOT(expiryTick()));
+    m_expiryTimer.start(EXPIRY_TICK_MS);
+}
+
+UserInterfaceMap::~UserInterfaceMap()
+{
+    // Hand back our icon atlas cells.
+    foreach (const QStringList& iconKeys, m_serviceIconKeys) {
+        foreach (QString key, iconKeys) {
+            IconAtlas::Instance()->release(key);
+        }
+    }
 }
 
 void UserInterfaceMap::addDevice(const RUIDevice& device)
 {
+    if (m_deviceMap.contains(device.m_uuid)) {
+        m_rootDevices.remove(m_deviceMap[device.m_uuid].m_rootDeviceUuid, device.m_uuid);
+    }
 
     m_deviceMap.insert(device.m_uuid, device);
+    m_rootDevices.insert(device.m_rootDeviceUuid, device.m_uuid);
 }
 
 bool UserInterfaceMap::deviceExists(const QString& uuid)
@@ -46,37 +149,67 @@ bool UserInterfaceMap::deviceExists(const QString& uuid)
 }
 
 // Note that we do not specifically track root devices, the ones that are discoverable. So we store the
-// root device uuid for each device recorded (ones that support RUI service).
-int UserInterfaceMap::checkForRemovedDevices(const QStringList& newDeviceList)
+// root device uuid for each device recorded (ones that support RUI service), and expire by root device.
+void UserInterfaceMap::touchDevice(const QString& rootDeviceUuid, int maxAgeSeconds)
+{
+    int ticks = (maxAgeSeconds * 1000 + EXPIRY_TICK_MS - 1) / EXPIRY_TICK_MS;
+
+    QMutexLocker lock(&m_expiryMutex);
+    m_expiryWheel.schedule(rootDeviceUuid, ticks);
+}
+
+int UserInterfaceMap::removeMissingDevices(const QStringList& rootDeviceUuids)
 {
+    TRACE_SCOPE("catalogue", "removeMissingDevices");
+
+    QSet<QString> present = QSet<QString>::fromList(rootDeviceUuids);
     int deleteCount = 0;
 
-    QStringList removeList;
+    foreach (QString rootDeviceUuid, m_rootDevices.uniqueKeys()) {
+        if (present.contains(rootDeviceUuid))
+            continue;
 
-    // Walk through our existing devices
-    QMapIterator<QString, RUIDevice> i(m_deviceMap);
-     while (i.hasNext()) {
-         i.next();
-         const RUIDevice device = i.value();
+        QMutexLocker lock(&m_expiryMutex);
+        m_expiryWheel.cancel(rootDeviceUuid);
+        lock.unlock();
 
-         // See if this device's rootDevice is contained in the new list.
-         if (!newDeviceList.contains(device.m_rootDeviceUuid)) {
+        foreach (QString deviceUuid, m_rootDevices.values(rootDeviceUuid)) {
+            fprintf(stderr, " - Removing device - not in server list: %s\n", deviceUuid.toUtf8().data());
+            removeDevice(deviceUuid);
+            deleteCount++;
+        }
+    }
 
-             // Remove this device (could be root or child)
-             removeList.append(device.m_uuid);
-             deleteCount++;
-         }
-     }
+    return deleteCount;
+}
 
-     foreach (QString deviceUuid, removeList) {
-         removeDevice(deviceUuid);
-     }
+void UserInterfaceMap::expiryTick()
+{
+    TRACE_SCOPE("catalogue", "expiryTick");
+
+    QMutexLocker lock(&m_expiryMutex);
+    QStringList expired = m_expiryWheel.advance();
+    lock.unlock();
+
+    int deleteCount = 0;
 
-     return deleteCount;
+    foreach (QString rootDeviceUuid, expired) {
+        QList<QString> devices = m_rootDevices.values(rootDeviceUuid);
+        foreach (QString deviceUuid, devices) {
+            fprintf(stderr, " - Removing device - max-age expired: %s\n", deviceUuid.toUtf8().data());
+            removeDevice(deviceUuid);
+            deleteCount++;
+        }
+    }
+
+    if (deleteCount > 0)
+        emit devicesExpired(deleteCount);
 }
 
 void UserInterfaceMap::removeDevice(const QString& uuid)
 {
+    TRACE_SCOPE("catalogue", "removeDevice");
+
     if (m_deviceMap.contains(uuid)) {
         RUIDevice device = m_deviceMap[uuid];
 
@@ -88,21 +221,169 @@ void UserInterfaceMap::removeDevice(const QString& uuid)
             removeServiceUIs(serviceKey);
         }
 
+        m_rootDevices.remove(device.m_rootDeviceUuid, uuid);
     }
 
     m_deviceMap.remove(uuid);
 }
 
+// Here to convert a service's UI list to its JavaScript form, collecting the transport hosts and
+// the icon atlas cells it holds.
+QVariantList UserInterfaceMap::serializeUIs(const QList<RUIInterface>& uiList, bool stale, QStringList& hosts, QStringList& iconKeys)
+{
+    QVariantList variants;
+
+    QListIterator<RUIInterface> iterator(uiList);
+    while (iterator.hasNext()) {
+        RUIInterface interface = iterator.next();
+        QVariantMap map = interface.toMap();
+
+        QString iconURL = IconCache::Instance()->iconURL(interface.m_iconList);
+        map["iconURL"] = iconURL;
+        if (iconURL.startsWith("rui-icon:")) {
+            QString key = IconCache::keyForURL(QUrl(iconURL));
+            QVariantMap cell = IconAtlas::Instance()->acquire(key);
+            if (!cell.isEmpty()) {
+                map["atlas"] = cell;
+                iconKeys.append(key);
+            }
+        }
+
+        if (stale)
+            map["stale"] = true;
+        variants.append(map);
+
+        // Collect RUI base URIs for the transport server map.
+        QListIterator<RUIProtocol> iter_protocol(interface.m_protocolList);
+        while (iter_protocol.hasNext()) {
+            RUIProtocol protocol = iter_protocol.next();
+
+            QListIterator<QString> iter_uri(protocol.m_uriList);
+            while (iter_uri.hasNext()) {
+                QString host = QUrl(iter_uri.next()).host();
+                if (!hosts.contains(host))
+                    hosts.append(host);
+            }
+        }
+    }
+
+    return variants;
+}
+
 void UserInterfaceMap::addServiceUIs(const QString& serviceKey, const QList<RUIInterface>& uiList)
 {
+    storeServiceUIs(serviceKey, uiList, false);
+}
+
+// Serialize the list once here, rather than on every generateUIList() call.
+void UserInterfaceMap::storeServiceUIs(const QString& serviceKey, const QList<RUIInterface>& uiList, bool stale)
+{
+    TRACE_SCOPE("catalogue", "storeServiceUIs");
+
+    QStringList hosts;
+    QStringList iconKeys;
+    QVariantList variants = serializeUIs(uiList, stale, hosts, iconKeys);
+
     QMutexLocker lock(&m_mutex);
+    bool changed = assignRevisions(serviceKey, variants, m_serviceUIVariants.value(serviceKey));
     m_serviceUIs.insert(serviceKey, uiList);
+    m_serviceUIVariants.insert(serviceKey, variants);
+    m_serviceHosts.insert(serviceKey, hosts);
+    QStringList oldIconKeys = m_serviceIconKeys.value(serviceKey);
+    m_serviceIconKeys.insert(serviceKey, iconKeys);
+    m_staleServices.removeAll(serviceKey);
+    if (stale)
+        m_staleServices.append(serviceKey);
+    if (changed)
+        m_uiListJsonValid = false;
+    rebuildTransportServers();
+    TRACE_COUNTER("catalogue", "services", m_serviceUIVariants.count());
+    lock.unlock();
+
+    // Released after the new list acquired its cells, so unchanged icons keep their place.
+    foreach (QString key, oldIconKeys) {
+        IconAtlas::Instance()->release(key);
+    }
 }
 
 void UserInterfaceMap::removeServiceUIs(const QString& serviceKey)
 {
+    TRACE_SCOPE("catalogue", "removeServiceUIs");
+
     QMutexLocker lock(&m_mutex);
+    if (!m_serviceUIVariants.value(serviceKey).isEmpty())
+        m_revision++;
     m_serviceUIs.remove(serviceKey);
+    m_serviceUIVariants.remove(serviceKey);
+    m_serviceHosts.remove(serviceKey);
+    QStringList iconKeys = m_serviceIconKeys.take(serviceKey);
+    m_staleServices.removeAll(serviceKey);
+    m_uiListJsonValid = false;
+    rebuildTransportServers();
+    lock.unlock();
+
+    foreach (QString key, iconKeys) {
+        IconAtlas::Instance()->release(key);
+    }
+}
+
+// Here to key a service's new UI list and stamp it with revisions, called with m_mutex held.
+// A UI equal to its previous version keeps that version's revision, so a re-announced list
+// doesn't make the page redraw. Returns true when the list changed.
+bool UserInterfaceMap::assignRevisions(const QString& serviceKey, QVariantList& variants, const QVariantList& previous)
+{
+    QHash<QString, QVariantMap> previousByKey;
+    foreach (const QVariant& variant, previous) {
+        QVariantMap map = variant.toMap();
+        previousByKey.insert(map.value("key").toString(), map);
+    }
+
+    int revision = m_revision + 1;
+    bool changed = variants.count() != previous.count();
+    QSet<QString> keys;
+
+    for (int i = 0; i < variants.count(); i++) {
+        QVariantMap map = variants[i].toMap();
+
+        // The uiID is only unique within a service (and not always that).
+        QString key = serviceKey + "#" + map.value("uiID").toString();
+        while (keys.contains(key))
+            key += "+";
+        keys.insert(key);
+        map["key"] = key;
+
+        QVariantMap old = previousByKey.value(key);
+        int oldRevision = old.take("revision").toInt();
+        if (!old.isEmpty() && old == map) {
+            map["revision"] = oldRevision;
+        } else {
+            map["revision"] = revision;
+            changed = true;
+        }
+
+        if (!changed && previous[i].toMap().value("key").toString() != key)
+            changed = true;
+
+        variants[i] = map;
+    }
+
+    if (changed)
+        m_revision = revision;
+    return changed;
+}
+
+// Called with m_mutex held.
+void UserInterfaceMap::rebuildTransportServers()
+{
+    m_transportServers.clear();
+
+    QMapIterator<QString, QStringList> i(m_serviceHosts);
+    while (i.hasNext()) {
+        i.next();
+        foreach (QString host, i.value()) {
+            m_transportServers.insert(host, host);
+        }
+    }
 }
 
 void UserInterfaceMap::dumpToConsole()
@@ -184,42 +465,212 @@ void UserInterfaceMap::dumpToConsole()
 
 QVariantList UserInterfaceMap::generateUIList()
 {
+    TRACE_SCOPE("catalogue", "generateUIList");
+
     QVariantList list;
 
     QMutexLocker lock(&m_mutex);
-    m_transportServers.clear();
 
-    QMapIterator<QString, QList<RUIInterface> > i(m_serviceUIs);
+    QMapIterator<QString, QVariantList> i(m_serviceUIVariants);
     while (i.hasNext()) {
         i.next();
-        const QList<RUIInterface> interfaceList = i.value();
+        list += i.value();
+    }
+    return list;
+}
 
-        QListIterator<RUIInterface> iterator(interfaceList);
+// Same content as generateUIList(), pre-serialized as a single JSON string. Handing one string
+// across the JavaScript bridge is far cheaper than marshalling a deep QVariantList.
+QString UserInterfaceMap::generateUIListJson()
+{
+    TRACE_SCOPE("catalogue", "generateUIListJson");
 
-        while (iterator.hasNext()) {
-            RUIInterface interface = iterator.next();
-            list.append( interface.toMap());
-
-            // Add RUI base URIs to the transport server map.
-            QListIterator<RUIProtocol> iter_protocol(interface.m_protocolList);
-            while (iter_protocol.hasNext()) {
-                RUIProtocol protocol = iter_protocol.next();
-
-                QListIterator<QString> iter_uri(protocol.m_uriList);
-                while (iter_uri.hasNext()) {
-                    QString uri = iter_uri.next();
-                    QUrl qurl(uri);
-                    QString host = qurl.host();
-                    m_transportServers.insert(host, host);
-                    if (m_transportServers.contains(host) == false) {
-                        fprintf(stderr,"Failed to add %s to map. Count: %d",
-                                host.toUtf8().data(), m_transportServers.count());
-                    }
-                }
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_uiListJsonValid) {
+        QVariantList list;
+        QMapIterator<QString, QVariantList> i(m_serviceUIVariants);
+        while (i.hasNext()) {
+            i.next();
+            list += i.value();
+        }
+
+        QJsonDocument document = QJsonDocument::fromVariant(list);
+        m_uiListJson = QString::fromUtf8(document.toJson(QJsonDocument::Compact));
+        m_uiListJsonValid = true;
+    }
+
+    return m_uiListJson;
+}
+
+// Here to return what the page needs to bring its copy of the list, last seen at sinceRevision,
+// up to date. Only changed UIs are serialized; the page reuses everything else.
+QString UserInterfaceMap::generateUIListDelta(int sinceRevision)
+{
+    TRACE_SCOPE("catalogue", "generateUIListDelta");
+
+    QMutexLocker lock(&m_mutex);
+
+    QVariantMap delta;
+    delta["revision"] = m_revision;
+
+    if (sinceRevision != m_revision) {
+        // A revision from a previous map (the benchmark recreates it) means start over.
+        if (sinceRevision > m_revision)
+            sinceRevision = 0;
+
+        QVariantList keys;
+        QVariantList changed;
+        foreach (const QVariantList& variants, m_serviceUIVariants) {
+            foreach (const QVariant& variant, variants) {
+                QVariantMap map = variant.toMap();
+                keys.append(map.value("key"));
+                if (map.value("revision").toInt() > sinceRevision)
+                    changed.append(variant);
             }
         }
+
+        delta["keys"] = keys;
+        delta["changed"] = changed;
     }
-    return list;
+
+    lock.unlock();
+
+    QJsonDocument document = QJsonDocument::fromVariant(delta);
+    return QString::fromUtf8(document.toJson(QJsonDocument::Compact));
+}
+
+// Here to write the catalogue (devices and their UI lists) to a versioned binary snapshot.
+bool UserInterfaceMap::saveSnapshot(const QString& fileName)
+{
+    TRACE_SCOPE("catalogue", "saveSnapshot");
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "Unable to write catalogue snapshot: %s\n", fileName.toUtf8().data());
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION;
+
+    QMutexLocker lock(&m_mutex);
+
+    out << qint32(m_deviceMap.count());
+    foreach (const RUIDevice& device, m_deviceMap)
+        writeDevice(out, device);
+
+    out << qint32(m_serviceUIs.count());
+    QMapIterator<QString, QList<RUIInterface> > i(m_serviceUIs);
+    while (i.hasNext()) {
+        i.next();
+        out << i.key() << qint32(i.value().count());
+        foreach (const RUIInterface& ui, i.value())
+            writeUI(out, ui);
+    }
+
+    lock.unlock();
+
+    return file.commit();
+}
+
+// Here at startup to seed the catalogue from a snapshot. All UIs are marked stale, and the
+// devices expire after maxAgeSeconds unless discovery confirms them.
+bool UserInterfaceMap::loadSnapshot(const QString& fileName, int maxAgeSeconds)
+{
+    TRACE_SCOPE("catalogue", "loadSnapshot");
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        fprintf(stderr, "Ignoring catalogue snapshot %s: unknown format\n", fileName.toUtf8().data());
+        return false;
+    }
+
+    QList<RUIDevice> devices;
+    QMap<QString, QList<RUIInterface> > serviceUIs;
+    qint32 count;
+
+    in >> count;
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++)
+        devices.append(readDevice(in));
+
+    in >> count;
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        QString serviceKey;
+        qint32 uiCount;
+        QList<RUIInterface> uiList;
+
+        in >> serviceKey >> uiCount;
+        for (int n = 0; n < uiCount && in.status() == QDataStream::Ok; n++)
+            uiList.append(readUI(in));
+
+        serviceUIs.insert(serviceKey, uiList);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        fprintf(stderr, "Ignoring catalogue snapshot %s: truncated\n", fileName.toUtf8().data());
+        return false;
+    }
+
+    foreach (const RUIDevice& device, devices) {
+        addDevice(device);
+        touchDevice(device.m_rootDeviceUuid, maxAgeSeconds);
+    }
+
+    QMapIterator<QString, QList<RUIInterface> > i(serviceUIs);
+    while (i.hasNext()) {
+        i.next();
+        storeServiceUIs(i.key(), i.value(), true);
+    }
+
+    fprintf(stderr, "Loaded catalogue snapshot: %d devices, %d services\n", devices.count(), serviceUIs.count());
+    return true;
+}
+
+void UserInterfaceMap::trimMemory()
+{
+    QMutexLocker lock(&m_mutex);
+    m_uiListJson = QString();
+    m_uiListJsonValid = false;
+}
+
+QStringList UserInterfaceMap::launchURIs()
+{
+    QMutexLocker lock(&m_mutex);
+
+    QStringList uris;
+    foreach (const QList<RUIInterface>& uiList, m_serviceUIs) {
+        foreach (const RUIInterface& ui, uiList) {
+            if (!ui.m_protocolList.isEmpty() && !ui.m_protocolList.first().m_uriList.isEmpty())
+                uris.append(ui.m_protocolList.first().m_uriList.first());
+        }
+    }
+    return uris;
+}
+
+QStringList UserInterfaceMap::deviceDescriptionURLs()
+{
+    QStringList urls;
+    foreach (const RUIDevice& device, m_deviceMap) {
+        if (!device.m_descriptionURL.isEmpty() && !urls.contains(device.m_descriptionURL))
+            urls.append(device.m_descriptionURL);
+    }
+    return urls;
+}
+
+QStringList UserInterfaceMap::staleServiceKeys()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_staleServices;
 }
 
 bool UserInterfaceMap::isHostRUITransportServer(const QString& host)
@@ -33,6 +33,10 @@
 #include <QList>
 #include <QStringList>
 #include <QMutex>
+#include <QMultiHash>
+#include <QTimer>
+
+#include "timerwheel.h"
 
 /* The following support classes are used by the UserInterfaceMap API:
  * - RUIIcon
@@ -191,6 +195,7 @@ public:
         m_uuid = other.m_uuid;
         m_serviceList = other.m_serviceList;
         m_rootDeviceUuid = other.m_rootDeviceUuid;
+        m_descriptionURL = other.m_descriptionURL;
         return *this;
     }
 
@@ -199,6 +204,9 @@ public:
     QString m_uuid;
     QString m_rootDeviceUuid;
 
+    // URL the device description was fetched from. Used to revalidate a persisted catalogue.
+    QString m_descriptionURL;
+
     // We are only interested in a service of type urn:schemas-upnp-org:service:RemoteUIServer:1
     // There should be 0 or 1 instances of this service type per device, but allow for multiples.
     // We only store devices that support this service - all others are discarded.
@@ -207,27 +215,88 @@ public:
 
 class UserInterfaceMap : public QObject
 {
+    Q_OBJECT
+
 public:
     explicit UserInterfaceMap(QObject *parent = 0);
+    ~UserInterfaceMap();
 
     void addDevice(const RUIDevice& device);
     void removeDevice(const QString& uuid);
     bool deviceExists(const QString& uuid);
     void addServiceUIs(const QString& serviceKey, const QList<RUIInterface>& list);
     void removeServiceUIs(const QString& serviceKey);
-    int checkForRemovedDevices( const QStringList& newDeviceList );
+
+    // Device expiry. A root device (and every device below it) is removed when it has not been
+    // touched within its max-age. May be called from the discovery thread.
+    void touchDevice(const QString& rootDeviceUuid, int maxAgeSeconds);
+
+    // Here with a full server list: root devices that aren't on it are removed right away.
+    int removeMissingDevices(const QStringList& rootDeviceUuids);
     bool isHostRUITransportServer( const QString& hostURL );
 
     QVariantList generateUIList();
+    QString generateUIListJson();
+
+    // Incremental form of the list. Every UI carries a stable "key" and the catalogue "revision"
+    // it last changed in. The delta holds the current revision, the keys in list order, and the
+    // UIs changed since sinceRevision; when nothing changed it holds the revision only.
+    QString generateUIListDelta(int sinceRevision);
+
+    // The URI each UI is launched with (the first URI of its first protocol).
+    QStringList launchURIs();
+
+    // Persisted catalogue. UIs loaded from a snapshot are reported as stale until their
+    // service list is replaced by addServiceUIs().
+    bool saveSnapshot(const QString& fileName);
+    bool loadSnapshot(const QString& fileName, int maxAgeSeconds);
+    QStringList deviceDescriptionURLs();
+    QStringList staleServiceKeys();
+
+    // Drops data that can be rebuilt (the cached JSON list), under memory pressure.
+    void trimMemory();
 
     // Debugging
     void dumpToConsole();
 
+signals:
+    void devicesExpired(int count);
+
+private slots:
+    void expiryTick();
+
 private:
+    void storeServiceUIs(const QString& serviceKey, const QList<RUIInterface>& list, bool stale);
+    QVariantList serializeUIs(const QList<RUIInterface>& list, bool stale, QStringList& hosts, QStringList& iconKeys);
+    bool assignRevisions(const QString& serviceKey, QVariantList& variants, const QVariantList& previous);
+    void rebuildTransportServers();
+
     QMap<QString, RUIDevice> m_deviceMap;
     QMap<QString, QList<RUIInterface> > m_serviceUIs;
     QMutex m_mutex;
     QMap<QString, QString> m_transportServers;
+
+    // Serialized (JavaScript ready) form of each service's UI list, and the RUI transport hosts
+    // referenced by it. Both are built once in addServiceUIs() and dropped with the service, so
+    // generateUIList() only has to concatenate them.
+    QMap<QString, QVariantList> m_serviceUIVariants;
+    QMap<QString, QStringList> m_serviceHosts;
+    QMap<QString, QStringList> m_serviceIconKeys;
+
+    // Compact JSON form of the whole list, valid until the next catalogue change.
+    QString m_uiListJson;
+    bool m_uiListJsonValid;
+
+    // Bumped on every change to the list: a UI added, changed, removed or moved.
+    int m_revision;
+
+    QStringList m_staleServices;
+
+    // Root device uuid -> uuids of the recorded devices below it (including the root itself).
+    QMultiHash<QString, QString> m_rootDevices;
+    TimerWheel m_expiryWheel;
+    QMutex m_expiryMutex;
+    QTimer m_expiryTimer;
 };
 
 #endif // USERINTERFACEMAP_H
@@ -1,31 +1,45 @@
-var uiList;
+var uiList = [];        // UIs in display order
+var uiByKey = {};       // the same UIs by key
+var uiRevision = 0;     // catalogue revision uiList was last brought up to
+var atlasURL = "";      // icon atlas the panels were last drawn with
 var screenIndex = 0;    // screen relative current (highlighted) index. (0:maxPanels-1)
 var scrollIndex = 0;    // base index of screenIndex:0
 var selectIndex = 0;    // effective index of corresponding rui element (screenIndex+scrollIndex)
 var maxPanels = 4;      // max panels to be displayed (arbitrary, based on vendors screen size)
 var panelCount = 0;     // actual panels to be displayed
 var flipped = false;    // flipped == true means the 'back' elements are in front and the 'front' elements are in back
-var uiElements;         // array of innerHtml content for each rui
-var canScroll;          // uiElements.length > panelCount
+var canScroll;          // uiList.length > panelCount
 var elementHeight = 86; // based on height of background images for the elements
-var uiElementCount = 0;
 
 
 function pageLoaded() {
 
-    uiElements = new Array();
+    proxyConnect();
 
-    // Page HTML with empty elements
-    generatePage();
+    if (typeof ruiHome != "undefined") {
 
-    proxyConnect();
+        // Served as rui:home: the panels are drawn and the list is inline, as of the time the
+        // page was rendered.
+        screenIndex = ruiHome.screenIndex;
+        scrollIndex = ruiHome.scrollIndex;
+        atlasURL = ruiHome.atlasURL;
+        applyRUIListDelta(ruiHome.list);
+
+    } else {
+
+        // Page HTML with empty elements
+        generatePage();
+
+        // Restore our last known position
+        screenIndex = discoveryProxy.screenIndex();
+        scrollIndex = discoveryProxy.scrollIndex();
+    }
 
-    // Restore our last known position
-    screenIndex = discoveryProxy.screenIndex();
-    scrollIndex = discoveryProxy.scrollIndex();
     selectIndex = screenIndex + scrollIndex;
 
+    // Picks up anything that changed since the page was rendered.
     refreshRUIList();
+    highlightSelection();
 }
 
 function proxyConnect() {
@@ -68,65 +82,78 @@ function updateSelected() {
     }
 }
 
-function generateRUIElements() {
-
-    uiList = discoveryProxy.ruiList();
-    var count = uiList.length;
+// Bring uiList up to date with the catalogue. Only UIs changed since our last revision come
+// across the bridge. Returns false when nothing changed.
+function updateRUIList() {
 
-    uiElements = new Array();
-
-    // There can be multiple urls for a given ui, which will result in additional divs
-    uiElementCount = 0;
+    return applyRUIListDelta(JSON.parse(discoveryProxy.ruiListDelta(uiRevision)));
+}
 
-    for (var i=0; i < count; i++) {
+function applyRUIListDelta(delta) {
 
-        var index = i;
+    uiRevision = delta.revision;
 
-        var generateUIDiv = function(ui) {
+    if (!delta.keys) {
+        return false;
+    }
 
-            var selected = (i == selectIndex) ? " selected" : "";
+    for (var i=0; i < delta.changed.length; i++) {
+        var ui = delta.changed[i];
+        uiByKey[ui.key] = ui;
+    }
 
-            var icon = selectIcon(ui);
-            var iconURL = icon.url;
+    // Rebuild the order, dropping removed UIs
+    var byKey = {};
+    uiList = new Array(delta.keys.length);
+    for (i=0; i < delta.keys.length; i++) {
+        var key = delta.keys[i];
+        uiList[i] = uiByKey[key];
+        byKey[key] = uiList[i];
+    }
+    uiByKey = byKey;
 
-            // TODO: read style sheet instead of using constant
-            //var paddingTop = (elementHeight - icon.height) / 2;
-            //var paddingLeft = (elementHeight - icon.width) / 2;
-            var paddingTop = 13;
-            var paddingLeft = 4;
+    canScroll = uiList.length > panelCount;
+    return true;
+}
 
-            var displayNumber = (uiElementCount + 1) % 10;
+function generateUIHtml(ui, index) {
 
-            var elementInnerHtml = "<div class='uiElementNumber" + selected + "'>";
-            elementInnerHtml += displayNumber;
-            elementInnerHtml += '</div>';
+    var selected = (index == selectIndex) ? " selected" : "";
 
-            elementInnerHtml += "<div class='uiElementName" + selected + "'>";
-            elementInnerHtml += "<div class='uiElementIcon' ";
-            elementInnerHtml += "style='padding-left:" + paddingLeft + "; padding-top: " + paddingTop + ";'>";
-            elementInnerHtml += "<img src='" + iconURL + "'/>";
-            elementInnerHtml += "</div>";
+    // The browser picks, scales and caches the best icon for us (rui-icon://).
+    var iconURL = ui.iconURL ? ui.iconURL : selectIcon(ui).url;
 
-            elementInnerHtml += "<div class='uiElementText'>";
-            elementInnerHtml += ui.name;
-            elementInnerHtml += "</div>";
-            elementInnerHtml += "</div>";
+    // TODO: read style sheet instead of using constant
+    //var paddingTop = (elementHeight - icon.height) / 2;
+    //var paddingLeft = (elementHeight - icon.width) / 2;
+    var paddingTop = 13;
+    var paddingLeft = 4;
 
-            var uiElem = new Object();
-            uiElem.uiID = ui.uiID;
-            uiElem.html = elementInnerHtml;
+    var displayNumber = (index + 1) % 10;
 
-            uiElements[uiElementCount] = uiElem;
-        }
-        generateUIDiv(uiList[index]);
+    var elementInnerHtml = "<div class='uiElementNumber" + selected + "'>";
+    elementInnerHtml += displayNumber;
+    elementInnerHtml += '</div>';
 
-        uiElementCount++;
+    elementInnerHtml += "<div class='uiElementName" + selected + "'>";
+    elementInnerHtml += "<div class='uiElementIcon' ";
+    elementInnerHtml += "style='padding-left:" + paddingLeft + "; padding-top: " + paddingTop + ";'>";
+    if (ui.atlas) {
+        var atlas = ui.atlas;
+        elementInnerHtml += "<div class='uiElementAtlasIcon' style='";
+        elementInnerHtml += "width: " + atlas.width + "px; height: " + atlas.height + "px; ";
+        elementInnerHtml += "background: url(" + atlasURL + ") -" + atlas.x + "px -" + atlas.y + "px no-repeat;'></div>";
+    } else {
+        elementInnerHtml += "<img src='" + iconURL + "'/>";
     }
+    elementInnerHtml += "</div>";
 
-    canScroll = true;
-    if (uiElements.length <= panelCount) {
-        canScroll = false;
-    }
+    elementInnerHtml += "<div class='uiElementText'>";
+    elementInnerHtml += ui.name;
+    elementInnerHtml += "</div>";
+    elementInnerHtml += "</div>";
+
+    return elementInnerHtml;
 }
 
 function generatePage() {
@@ -173,46 +200,46 @@ function generatePage() {
 }
 
 // Load either the front or back faces.
-// This is required for an initial load and prior to a flip animation.
+// This is required for an initial load and prior to a flip animation. Each face remembers what
+// it shows (key, revision and position), so only faces showing something else are rewritten.
 function loadPanelElements(face, start) {
 
-    if (uiElements.length == 0)
-        return;
-
     var elems = document.getElementsByClassName(face);
-    for(i=0; i<elems.length; i++)  {
-        var currentHtml = elems[i].innerHTML;
+    for(var i=0; i<elems.length; i++)  {
 
         var index = start+i;
+        var ui = (index < uiList.length) ? uiList[index] : null;
 
-        var html = "";
-        var uiID = "";
-        var count = uiElements.length;
-
-        if (index < count) {
-            html = uiElements[index].html;
-            uiID = uiElements[index].uiID;
+        var stamp = "";
+        if (ui) {
+            stamp = ui.key + "@" + ui.revision + "#" + index;
+            if (ui.atlas) {
+                stamp += " " + atlasURL;
+            }
         }
 
-        if (face == "front") {
-            $(elems[i]).html(html);
-        }
-        else if (face == "back") {
-            $(elems[i]).html(html);
+        if (elems[i].getAttribute('data-stamp') === stamp) {
+            continue;
         }
+
+        elems[i].setAttribute('data-stamp', stamp);
+        $(elems[i]).html(ui ? generateUIHtml(ui, index) : "");
     }
 }
 
 // Here with an update list of RUIs
 function refreshRUIList() {
 
-    // Start with empty page so we handle deletions properly
-    generatePage();
+    var listChanged = updateRUIList();
 
-    // Array of innerHtml elements
-    generateRUIElements();
+    // New icons painted into the atlas only affect the panels drawn from it.
+    var currentAtlasURL = discoveryProxy.iconAtlasURL();
+    if (!listChanged && currentAtlasURL == atlasURL) {
+        return;
+    }
+    atlasURL = currentAtlasURL;
 
-    // Insert element HTML
+    // Patch the panels showing a changed UI
     loadPanelElements('front', scrollIndex);
     loadPanelElements('back', scrollIndex);
 
@@ -220,8 +247,21 @@ function refreshRUIList() {
     updateSelected();
 }
 
-// TODO: Select from the list based on best size match.
-// For now just grab the first one.
+// Here to redraw the page from scratch, as every update did before updates were patched in.
+// Kept for the renderer benchmark.
+function rebuildRUIList() {
+
+    generatePage();
+
+    uiList = [];
+    uiByKey = {};
+    uiRevision = 0;
+    atlasURL = "";
+
+    refreshRUIList();
+}
+
+// Fallback only, the best size match is made by the browser (see ui.iconURL).
 function selectIcon(ui) {
 
     if (ui.iconList.length > 0) {
@@ -282,6 +322,15 @@ function recordScreenPosition() {
     // Save our state.
     discoveryProxy.setScrollIndex(scrollIndex);
     discoveryProxy.setScreenIndex(screenIndex);
+
+    highlightSelection();
+}
+
+// Let the browser warm up a connection to the highlighted RUI.
+function highlightSelection() {
+    if (selectIndex < uiList.length) {
+        discoveryProxy.highlightUI(uiList[selectIndex].protocolList[0].uriList[0]);
+    }
 }
 
 function onKeydown(ev) {
@@ -317,10 +366,10 @@ function onKeydown(ev) {
 
     case 40:
         // down arrow
-        if (screenIndex < (panelCount-1) && screenIndex < (uiElementCount-1)) {
+        if (screenIndex < (panelCount-1) && screenIndex < (uiList.length-1)) {
             screenIndex++;
             recordScreenPosition();
-        } else if (canScroll && (scrollIndex < (uiElements.length-panelCount))) {
+        } else if (canScroll && (scrollIndex < (uiList.length-panelCount))) {
             scrollDown();
             recordScreenPosition();
         }
@@ -381,7 +430,7 @@ function selectUI(index) {
         var uri = uiList[index].protocolList[0].uriList[0];
 
         //discoveryProxy.console("select ui: " + index + "  " + uiList[index].name + "  url: " + uri );
-        window.location.href = uri;
+        discoveryProxy.selectUI(uri);
     }
 }
 